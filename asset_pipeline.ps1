@@ -77,29 +77,102 @@ function Invoke-CreateAssetSymlink() {
     }
 }
 
-function Invoke-CompileShaders() {
-    # Compile shaders
-    # All shaders matching the pattern ./assets/shaders/*.glsl will be compiled into ./assets/shaders/__generated__/*.spv
-    $shader_dir = "$PSScriptRoot\$assetDir\shaders"
-    $shader_generated_dir = "$shader_dir\__generated__"
+function Invoke-BundleShaders() {
+    # Bundle shader sources into ./assets/shaders/shaders.bundle so the renderer loads them in one read
+    # Layout must match src/cauldron/shader_bundle.h
+    $shader_dir = "$PSScriptRoot\$asset_dir\shaders"
+    $bundle_path = "$shader_dir\shaders.bundle"
 
     if ($clean -eq $true) {
-        Write-Host "Removing compiled shaders..."
-        Remove-Item $shader_generated_dir -Recurse -Force -ErrorAction Ignore | Out-Null
+        Write-Host "Removing shader bundle..."
+        Remove-Item $bundle_path -Force -ErrorAction Ignore | Out-Null
         return
     }
 
-    Write-Host "Compilng shaders..."
+    Write-Host "Bundling shaders..."
+
+    $shaders = @(Get-ChildItem $shader_dir\* -Include *.vert, *.frag | Sort-Object Name)
+    $sources = @($shaders | ForEach-Object { [System.IO.File]::ReadAllBytes($_.FullName) })
+
+    $stream = [System.IO.File]::Create($bundle_path)
+    $writer = New-Object System.IO.BinaryWriter($stream)
+    try {
+        $writer.Write([uint32]0x42444853) # "SHDB"
+        $writer.Write([uint32]1)
+        $writer.Write([uint32]$shaders.Count)
+
+        # sources start after the header and entry table, each is followed by a null terminator
+        $offset = 12 + 72 * $shaders.Count
+        for ($i = 0; $i -lt $shaders.Count; $i++) {
+            $name = New-Object byte[] 64
+            $name_bytes = [System.Text.Encoding]::ASCII.GetBytes($shaders[$i].Name)
+            [System.Array]::Copy($name_bytes, $name, [System.Math]::Min($name_bytes.Length, 63))
+            $writer.Write($name)
+            $writer.Write([uint32]$offset)
+            $writer.Write([uint32]$sources[$i].Length)
+            $offset += $sources[$i].Length + 1
+        }
+
+        foreach ($source in $sources) {
+            $writer.Write($source)
+            $writer.Write([byte]0)
+        }
+    }
+    finally {
+        $writer.Close()
+    }
+}
+
+function Invoke-PackAtlases() {
+    # Pack the sprite atlases into ./assets/sprites.atlas and ./assets/sprites_<page>.png
+    # The sheet list and cell sizes must match k_atlases in src/cauldron/sprite_draw.c
+    $atlas_dir = "$PSScriptRoot\$asset_dir"
+    $atlas_path = "$atlas_dir\sprites.atlas"
+
+    if ($clean -eq $true) {
+        Write-Host "Removing packed atlases..."
+        Remove-Item $atlas_path -Force -ErrorAction Ignore | Out-Null
+        Remove-Item "$atlas_dir\sprites_*.png" -Force -ErrorAction Ignore | Out-Null
+        return
+    }
+
+    $packer = Get-ChildItem "$PSScriptRoot\bin\atlas_packer\bin" -Recurse -Filter atlas_packer.exe -ErrorAction Ignore |
+    Select-Object -First 1
+
+    if ($null -eq $packer) {
+        Write-Host "Skipping atlas packing because atlas_packer has not been built."
+        return
+    }
 
-    New-Item -ItemType Directory $shader_generated_dir -ErrorAction Ignore | Out-Null
+    Write-Host "Packing atlases..."
+
+    & $packer.FullName -o $atlas_path `
+        "$atlas_dir\atlas2.png:8x8" `
+        "$atlas_dir\wizard_sheet.png:8x8"
+}
 
-    Get-ChildItem $shader_dir\* -Include *.glsl, *.vert, *.frag, *.geom, *.tesc, *.tese, *.comp |
-    ForEach-Object {
-        $shader_path = Get-Item $_ | Resolve-Path -Relative
-        $shader_name = $_.Name
-        $output_file = "$shader_generated_dir\$shader_name.spv"
-        glslangValidator.exe -V $shader_path -o $output_file
+function Invoke-CookLevels() {
+    # Cook ./assets/test_level.json into ./assets/test_level.lvlpack with the game's --cook-level mode
+    $level_dir = "$PSScriptRoot\$asset_dir"
+    $pack_path = "$level_dir\test_level.lvlpack"
+
+    if ($clean -eq $true) {
+        Write-Host "Removing cooked levels..."
+        Remove-Item $pack_path -Force -ErrorAction Ignore | Out-Null
+        return
     }
+
+    $game = Get-ChildItem "$PSScriptRoot\bin\cauldron\bin" -Recurse -Filter cauldron.exe -ErrorAction Ignore |
+    Select-Object -First 1
+
+    if ($null -eq $game) {
+        Write-Host "Skipping level cooking because cauldron has not been built."
+        return
+    }
+
+    Write-Host "Cooking levels..."
+
+    & $game.FullName --cook-level "$level_dir\test_level.json" $pack_path
 }
 
 $platform_group = $platform_groups[$platform]
@@ -110,4 +183,6 @@ foreach ($platform in $platform_group) {
         Invoke-CreateAssetSymlink -platform $platform -configuration $configuration
     }
 }
-Invoke-CompileShaders
+Invoke-BundleShaders
+Invoke-PackAtlases
+Invoke-CookLevels
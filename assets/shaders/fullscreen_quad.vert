@@ -1,5 +1,7 @@
 #version 330
 
+uniform vec4 uv_rect; // x, y: offset -- z, w: scale of the canvas region to sample
+
 out vec2 uv;
 
 void main()
@@ -8,5 +10,5 @@ void main()
     float y = float(((uint(gl_VertexID) + 1u) / 3u) % 2u);
 
     gl_Position = vec4(-1.0f + x * 2.0f, -1.0f + y * 2.0f, 0.0f, 1.0f);
-    uv = vec2(x, y);
+    uv = uv_rect.xy + vec2(x, y) * uv_rect.zw;
 }
@@ -1,8 +1,8 @@
 #version 330
 
-uniform sampler2D atlas;
+uniform sampler2DArray atlas;
 
-in vec2 uv;
+in vec3 uv;
 
 out vec4 frag_color;
 
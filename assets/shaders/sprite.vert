@@ -2,17 +2,72 @@
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec2 texcoord0;
-layout(location = 2) in vec3 inst_pos;
-layout(location = 3) in vec4 spr_rect;   // pos: x,y -- size: z,w
-layout(location = 4) in vec2 spr_origin; // 0,0 : top left, 0.5,0.5: center, 1,1: bottom right
+layout(location = 2) in vec4 inst_data;   // fixed point x, y, layer -- w: sprite id
+layout(location = 3) in vec4 inst_params; // x: flip, anim mode bits -- y,z: origin -- w: frames
+layout(location = 4) in vec2 inst_anim;   // x: start tick -- y: 8.8 fixed point fps, unorm16
 
 uniform mat4 view_proj;
-out vec2 uv;
+uniform vec4 inst_dequant; // x: position scale, y: layer scale, z: anim tick length, w: fps scale
+uniform float time;        // anim ticks, wrapped at TICK_WRAP
+
+const int ANIM_LOOP = 0;
+const int ANIM_ONCE = 1;
+const int ANIM_PING_PONG = 2;
+const float TICK_WRAP = 65536.0f;
+
+// two texels per sprite id: uv rect (x, y, w, h) then world size (x, y) and atlas layer (z)
+uniform sampler2D sprite_rects;
+
+out vec3 uv;
+
+// frame of an animation clip at the current time, single frame sprites always return 0
+int anim_frame()
+{
+    int frame_count = int(inst_params.w);
+    if (frame_count <= 1) {
+        return 0;
+    }
+
+    int mode = (int(inst_params.x) >> 2) & 3;
+    vec2 anim = round(inst_anim * 65535.0f);
+
+    // ticks since the start wrap around, clips played once count the upper half as not started yet
+    float ticks = mod(time - anim.x, TICK_WRAP);
+    if (mode == ANIM_ONCE && ticks >= TICK_WRAP * 0.5f) {
+        ticks = 0.0f;
+    }
+
+    float seconds = ticks * inst_dequant.z;
+    int frame = int(floor(seconds * anim.y * inst_dequant.w));
+    if (mode == ANIM_ONCE) {
+        return min(frame, frame_count - 1);
+    }
+    if (mode == ANIM_PING_PONG) {
+        int period = frame_count * 2 - 2;
+        frame %= period;
+        return frame < frame_count ? frame : period - frame;
+    }
+    return frame % frame_count;
+}
 
 void main()
 {
-    uv = texcoord0 * spr_rect.zw + spr_rect.xy;
-    vec3 origin = vec3(clamp(spr_origin, vec2(0, 0), vec2(1, 1)), 0.0f);
-    vec3 pos = position + inst_pos - origin;
+    int sprite_id = int(inst_data.w) + anim_frame();
+    int flip = int(inst_params.x) & 3;
+
+    int rects_per_row = textureSize(sprite_rects, 0).x / 2;
+    ivec2 texel = ivec2((sprite_id % rects_per_row) * 2, sprite_id / rects_per_row);
+    vec4 rect = texelFetch(sprite_rects, texel, 0);
+    vec4 info = texelFetch(sprite_rects, texel + ivec2(1, 0), 0);
+
+    // flipping mirrors the texcoords within the rect
+    vec2 flip_mask = vec2(flip & 1, (flip >> 1) & 1);
+    uv = vec3(rect.xy + mix(texcoord0, 1.0f - texcoord0, flip_mask) * rect.zw, info.z);
+
+    // 0,0 : top left, 0.5,0.5: center, 1,1: bottom right
+    vec2 size = info.xy;
+    vec2 origin = inst_params.yz / 255.0f;
+    vec3 inst_pos = vec3(inst_data.xy * inst_dequant.x, inst_data.z * inst_dequant.y);
+    vec3 pos = vec3((position.xy - origin) * size, position.z) + inst_pos;
     gl_Position = view_proj * vec4(pos, 1.0f);
 }
@@ -1,5 +1,45 @@
 VULKAN_SDK = os.getenv("VULKAN_SDK")
 
+-- Writes src/cauldron/shader_bundle.gen.h with every shader in assets/shaders as string literals,
+-- release builds compile it in so startup reads no shader files. Runs before every cauldron build
+-- and only rewrites the header when a shader changed.
+newaction {
+    trigger = "embed_shaders",
+    description = "Generate src/cauldron/shader_bundle.gen.h from assets/shaders",
+    execute = function()
+        local shader_dir = path.join(_MAIN_SCRIPT_DIR, "assets/shaders")
+        local header_path = path.join(_MAIN_SCRIPT_DIR, "src/cauldron/shader_bundle.gen.h")
+        local shaders = table.join(
+            os.matchfiles(shader_dir .. "/*.vert"),
+            os.matchfiles(shader_dir .. "/*.frag"))
+        table.sort(shaders, function(a, b) return path.getname(a) < path.getname(b) end)
+
+        -- one string literal per source line keeps every piece well below the compiler's limits
+        local lines = {
+            "// shader_bundle.gen.h - generated by premake5.lua from assets/shaders, do not edit",
+            "",
+            "#pragma once",
+            "",
+            "static const shader_embedded_source k_embedded_shaders[] = {",
+        }
+        for _, file in ipairs(shaders) do
+            table.insert(lines, '    {"' .. path.getname(file) .. '",')
+            local source = io.readfile(file):gsub("\r", "")
+            for line in (source:gsub("\n$", "") .. "\n"):gmatch("(.-)\n") do
+                local escaped = line:gsub("\\", "\\\\"):gsub('"', '\\"'):gsub("\t", "\\t")
+                table.insert(lines, '     "' .. escaped .. '\\n"')
+            end
+            table.insert(lines, "    },")
+        end
+        table.insert(lines, "};")
+
+        local header = table.concat(lines, "\n") .. "\n"
+        if io.readfile(header_path) ~= header then
+            io.writefile(header_path, header)
+        end
+    end
+}
+
 workspace "cauldron"
     configurations { "Debug", "Release" }
     platforms { "Linux64", "Win64", "Win32" }
@@ -39,6 +79,9 @@ project "cauldron"
     links { "cimgui" }
     includedirs { "src/cimgui" }
     cppdialect "C++latest"
+    prebuildcommands {
+        '"' .. _PREMAKE_COMMAND .. '" --file="' .. _MAIN_SCRIPT .. '" embed_shaders'
+    }
     --postbuildcommands { "powershell.exe -File ../../asset_pipeline.ps1 -target %{prj.name} -platform %{cfg.platform} -configuration %{cfg.buildcfg}" }
 
     filter "platforms:Win64"
@@ -70,3 +113,31 @@ project "cauldron"
         defines { "_NDEBUG" }
         optimize "On"
 
+project "atlas_packer"
+    kind "ConsoleApp"
+    language "C"
+    location "bin/atlas_packer"
+    files "src/atlas_packer/**.c"
+    includedirs { "src/cauldron", "src/cimgui" }
+
+    filter "platforms:Win64"
+        system "Windows"
+        defines { "_CRT_SECURE_NO_WARNINGS" }
+        architecture "x86_64"
+
+    filter "platforms:Win32"
+        system "Windows"
+        defines { "_CRT_SECURE_NO_WARNINGS" }
+        architecture "x86"
+
+    filter "platforms:Linux64"
+        system "Linux"
+        architecture "x86_64"
+
+    filter "configurations:Debug"
+        defines { "_DEBUG" }
+        symbols "On"
+
+    filter "configurations:Release"
+        defines { "_NDEBUG" }
+        optimize "On"
@@ -0,0 +1,466 @@
+// atlas_packer - Offline sprite atlas packer
+// Slices loose sprite sheets into cells, packs the unique cells into power of two pages with
+// stb_rect_pack and writes the pages as png alongside a binary rect table (sprite_atlas_format.h)
+// that the sprite renderer loads directly.
+//
+// usage: atlas_packer [-o assets/sprites.atlas] [-s max_page_size] sheet.png[:WxH] ...
+//   sheets without a cell size are packed as a single sprite
+
+#include "sprite_atlas_format.h"
+
+#define STB_DS_IMPLEMENTATION
+#include "stb_ds.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imgui/imstb_rectpack.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    K_MIN_PAGE_SIZE = 64,
+    K_DEFAULT_MAX_PAGE_SIZE = 2048,
+};
+
+struct source {
+    const char* path;
+    uint32_t cell_w;
+    uint32_t cell_h;
+    int width;
+    int height;
+    unsigned char* pixels;
+};
+
+// a distinct cell image, sprites with identical pixels share one
+struct cell {
+    uint32_t source;
+    uint32_t x;
+    uint32_t y;
+    uint32_t w;
+    uint32_t h;
+    uint32_t page;
+    uint32_t page_x;
+    uint32_t page_y;
+};
+
+struct cell_lookup {
+    size_t key; // hash of the cell's pixels
+    uint32_t value;
+};
+
+struct source* sources = NULL;           // stbds_arr
+struct cell* cells = NULL;               // stbds_arr
+int32_t* sprite_cells = NULL;            // stbds_arr, cell index per sprite id, -1 when empty
+struct cell_lookup* cell_lookup = NULL;  // stbds_hm, collisions fall through to a linear scan
+stbrp_rect* pack_rects = NULL;           // stbds_arr, indexed by cell
+
+static void print_usage(void)
+{
+    printf("usage: atlas_packer [-o out.atlas] [-s max_page_size] sheet.png[:WxH] ...\n");
+}
+
+static bool is_pow2(uint32_t v)
+{
+    return v && !(v & (v - 1));
+}
+
+static const char* path_filename(const char* path)
+{
+    const char* slash = strrchr(path, '/');
+    const char* bslash = strrchr(path, '\\');
+    slash = (bslash > slash) ? bslash : slash;
+    return slash ? slash + 1 : path;
+}
+
+static const unsigned char* cell_row(const struct source* src, uint32_t x, uint32_t y)
+{
+    return src->pixels + ((size_t)y * src->width + x) * 4;
+}
+
+// the sprite shader treats pure black as transparent so those cells are empty as well
+static bool cell_is_empty(const struct source* src, uint32_t x, uint32_t y, uint32_t w, uint32_t h)
+{
+    for (uint32_t row = 0; row < h; ++row) {
+        const unsigned char* px = cell_row(src, x, y + row);
+        for (uint32_t col = 0; col < w; ++col, px += 4) {
+            if (px[3] != 0 && (px[0] | px[1] | px[2]) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool cells_equal(const struct cell* a, const struct cell* b)
+{
+    if (a->w != b->w || a->h != b->h) {
+        return false;
+    }
+
+    const struct source* src_a = &sources[a->source];
+    const struct source* src_b = &sources[b->source];
+    for (uint32_t row = 0; row < a->h; ++row) {
+        const unsigned char* row_a = cell_row(src_a, a->x, a->y + row);
+        const unsigned char* row_b = cell_row(src_b, b->x, b->y + row);
+        if (memcmp(row_a, row_b, (size_t)a->w * 4) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t cell_hash(const struct cell* cell)
+{
+    const struct source* src = &sources[cell->source];
+    size_t hash = stbds_hash_bytes((void*)&cell->w, sizeof(cell->w) * 2, 0);
+    for (uint32_t row = 0; row < cell->h; ++row) {
+        const unsigned char* px = cell_row(src, cell->x, cell->y + row);
+        hash = stbds_hash_bytes((void*)px, (size_t)cell->w * 4, hash);
+    }
+    return hash;
+}
+
+// returns the cell index for the given pixels, adding a new cell when nothing identical exists yet
+static uint32_t add_cell(struct cell cell)
+{
+    size_t hash = cell_hash(&cell);
+    ptrdiff_t found = hmgeti(cell_lookup, hash);
+    if (found >= 0) {
+        uint32_t index = cell_lookup[found].value;
+        if (cells_equal(&cells[index], &cell)) {
+            return index;
+        }
+
+        for (uint32_t i = 0; i < (uint32_t)arrlen(cells); ++i) {
+            if (cells_equal(&cells[i], &cell)) {
+                return i;
+            }
+        }
+    }
+
+    uint32_t index = (uint32_t)arrlen(cells);
+    arrput(cells, cell);
+    if (found < 0) {
+        hmput(cell_lookup, hash, index);
+    }
+    return index;
+}
+
+static bool parse_source(const char* arg, struct source* out)
+{
+    *out = (struct source){.path = arg};
+
+    // allow drive letters, the cell size follows the last ':'
+    const char* sep = strrchr(arg, ':');
+    if (sep && sep - arg > 1) {
+        unsigned w, h;
+        if (sscanf(sep + 1, "%ux%u", &w, &h) != 2 || w == 0 || h == 0) {
+            fprintf(stderr, "invalid cell size in '%s'\n", arg);
+            return false;
+        }
+
+        size_t len = (size_t)(sep - arg);
+        char* path = malloc(len + 1);
+        memcpy(path, arg, len);
+        path[len] = '\0';
+        out->path = path;
+        out->cell_w = w;
+        out->cell_h = h;
+    }
+
+    int ichan;
+    out->pixels = stbi_load(out->path, &out->width, &out->height, &ichan, 4);
+    if (!out->pixels) {
+        fprintf(stderr, "failed to load '%s': %s\n", out->path, stbi_failure_reason());
+        return false;
+    }
+
+    if (out->cell_w == 0) {
+        out->cell_w = (uint32_t)out->width;
+        out->cell_h = (uint32_t)out->height;
+    }
+
+    if (strlen(path_filename(out->path)) >= SPRITE_ATLAS_PATH_LEN) {
+        fprintf(stderr, "source file name too long '%s'\n", out->path);
+        return false;
+    }
+
+    return true;
+}
+
+// Packs every rect not yet packed into a page of the given size, returns the number placed.
+static uint32_t pack_page(uint32_t page, uint32_t width, uint32_t height, bool commit)
+{
+    static stbrp_node* nodes = NULL; // stbds_arr
+    arrsetlen(nodes, width);
+
+    stbrp_rect* pending = NULL; // stbds_arr
+    for (uint32_t i = 0; i < (uint32_t)arrlen(pack_rects); ++i) {
+        if (!pack_rects[i].was_packed) {
+            arrput(pending, pack_rects[i]);
+        }
+    }
+
+    stbrp_context ctx;
+    stbrp_init_target(&ctx, (int)width, (int)height, nodes, (int)width);
+    stbrp_pack_rects(&ctx, pending, (int)arrlen(pending));
+
+    uint32_t placed = 0;
+    for (uint32_t i = 0; i < (uint32_t)arrlen(pending); ++i) {
+        if (!pending[i].was_packed) {
+            continue;
+        }
+
+        ++placed;
+        if (commit) {
+            struct cell* cell = &cells[pending[i].id];
+            cell->page = page;
+            cell->page_x = pending[i].x;
+            cell->page_y = pending[i].y;
+            pack_rects[pending[i].id].was_packed = 1;
+        }
+    }
+
+    arrfree(pending);
+    return placed;
+}
+
+// Picks the smallest power of two page, square or twice as wide as tall, that holds every cell.
+// Returns false when the cells need more than one page of the maximum size.
+static bool choose_page_size(uint32_t max_size, uint32_t* out_w, uint32_t* out_h)
+{
+    uint64_t area = 0;
+    uint32_t max_w = 0, max_h = 0;
+    for (uint32_t i = 0; i < (uint32_t)arrlen(cells); ++i) {
+        area += (uint64_t)cells[i].w * cells[i].h;
+        max_w = (cells[i].w > max_w) ? cells[i].w : max_w;
+        max_h = (cells[i].h > max_h) ? cells[i].h : max_h;
+    }
+
+    for (uint32_t h = K_MIN_PAGE_SIZE / 2; h <= max_size; h *= 2) {
+        for (uint32_t w = h; w <= h * 2 && w <= max_size; w *= 2) {
+            if (w < K_MIN_PAGE_SIZE || (uint64_t)w * h < area || w < max_w || h < max_h) {
+                continue;
+            }
+
+            if (pack_page(0, w, h, false) == (uint32_t)arrlen(pack_rects)) {
+                *out_w = w;
+                *out_h = h;
+                return true;
+            }
+        }
+    }
+
+    *out_w = max_size;
+    *out_h = max_size;
+    return false;
+}
+
+static bool write_page(const char* path, uint32_t page, uint32_t width, uint32_t height)
+{
+    unsigned char* pixels = calloc((size_t)width * height, 4);
+    if (!pixels) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < (uint32_t)arrlen(cells); ++i) {
+        const struct cell* cell = &cells[i];
+        if (cell->page != page) {
+            continue;
+        }
+
+        const struct source* src = &sources[cell->source];
+        for (uint32_t row = 0; row < cell->h; ++row) {
+            memcpy(
+                pixels + ((size_t)(cell->page_y + row) * width + cell->page_x) * 4,
+                cell_row(src, cell->x, cell->y + row),
+                (size_t)cell->w * 4);
+        }
+    }
+
+    int ok = stbi_write_png(path, (int)width, (int)height, 4, pixels, (int)width * 4);
+    free(pixels);
+    return ok != 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* out_path = "assets/sprites.atlas";
+    uint32_t max_page_size = K_DEFAULT_MAX_PAGE_SIZE;
+
+    int argi = 1;
+    for (; argi < argc && argv[argi][0] == '-'; ++argi) {
+        if (strcmp(argv[argi], "-o") == 0 && argi + 1 < argc) {
+            out_path = argv[++argi];
+        } else if (strcmp(argv[argi], "-s") == 0 && argi + 1 < argc) {
+            max_page_size = (uint32_t)strtoul(argv[++argi], NULL, 10);
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (argi >= argc || !is_pow2(max_page_size) || max_page_size < K_MIN_PAGE_SIZE ||
+        max_page_size > UINT16_MAX) {
+        print_usage();
+        return 1;
+    }
+
+    // slice every source into cells, skipping empty cells and folding duplicates
+    for (; argi < argc; ++argi) {
+        struct source src;
+        if (!parse_source(argv[argi], &src)) {
+            return 1;
+        }
+
+        uint32_t source_index = (uint32_t)arrlen(sources);
+        arrput(sources, src);
+
+        for (uint32_t cy = 0; cy + src.cell_h <= (uint32_t)src.height; cy += src.cell_h) {
+            for (uint32_t cx = 0; cx + src.cell_w <= (uint32_t)src.width; cx += src.cell_w) {
+                if (cell_is_empty(&src, cx, cy, src.cell_w, src.cell_h)) {
+                    arrput(sprite_cells, -1);
+                    continue;
+                }
+
+                struct cell cell = {
+                    .source = source_index,
+                    .x = cx,
+                    .y = cy,
+                    .w = src.cell_w,
+                    .h = src.cell_h,
+                };
+                arrput(sprite_cells, (int32_t)add_cell(cell));
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < (uint32_t)arrlen(cells); ++i) {
+        if (cells[i].w > max_page_size || cells[i].h > max_page_size) {
+            fprintf(stderr, "cell larger than the maximum page size %u\n", max_page_size);
+            return 1;
+        }
+
+        arrput(
+            pack_rects,
+            ((stbrp_rect){
+                .id = (int)i,
+                .w = (stbrp_coord)cells[i].w,
+                .h = (stbrp_coord)cells[i].h,
+            }));
+    }
+
+    uint32_t page_w, page_h;
+    choose_page_size(max_page_size, &page_w, &page_h);
+
+    uint32_t page_count = 0;
+    for (uint32_t packed = 0; packed < (uint32_t)arrlen(pack_rects); ++page_count) {
+        packed += pack_page(page_count, page_w, page_h, true);
+    }
+    page_count = (page_count > 0) ? page_count : 1;
+
+    // pages are written next to the rect table as <name>_<page>.png
+    const char* out_name = path_filename(out_path);
+    size_t out_dir_len = (size_t)(out_name - out_path);
+    size_t stem_len = strcspn(out_name, ".");
+
+    sprite_atlas_page* pages = calloc(page_count, sizeof(sprite_atlas_page));
+    for (uint32_t page = 0; page < page_count; ++page) {
+        int len = snprintf(
+            pages[page].path,
+            SPRITE_ATLAS_PATH_LEN,
+            "%.*s_%u.png",
+            (int)stem_len,
+            out_name,
+            page);
+        if (len < 0 || len >= SPRITE_ATLAS_PATH_LEN) {
+            fprintf(stderr, "output name too long '%s'\n", out_path);
+            return 1;
+        }
+
+        char page_path[1024];
+        snprintf(
+            page_path,
+            sizeof(page_path),
+            "%.*s%s",
+            (int)out_dir_len,
+            out_path,
+            pages[page].path);
+        if (!write_page(page_path, page, page_w, page_h)) {
+            fprintf(stderr, "failed to write '%s'\n", page_path);
+            return 1;
+        }
+    }
+
+    sprite_atlas_source* table_sources = calloc(arrlen(sources), sizeof(sprite_atlas_source));
+    uint32_t first_id = 0;
+    for (uint32_t i = 0; i < (uint32_t)arrlen(sources); ++i) {
+        const struct source* src = &sources[i];
+        uint32_t count = (src->width / src->cell_w) * (src->height / src->cell_h);
+        table_sources[i] = (sprite_atlas_source){
+            .cell_w = src->cell_w,
+            .cell_h = src->cell_h,
+            .first_id = first_id,
+            .count = count,
+        };
+        strcpy(table_sources[i].path, path_filename(src->path));
+        first_id += count;
+    }
+
+    sprite_atlas_rect* rects = calloc(arrlen(sprite_cells), sizeof(sprite_atlas_rect));
+    for (uint32_t i = 0; i < (uint32_t)arrlen(sprite_cells); ++i) {
+        if (sprite_cells[i] < 0) {
+            continue;
+        }
+
+        const struct cell* cell = &cells[sprite_cells[i]];
+        rects[i] = (sprite_atlas_rect){
+            .x = (uint16_t)cell->page_x,
+            .y = (uint16_t)cell->page_y,
+            .w = (uint16_t)cell->w,
+            .h = (uint16_t)cell->h,
+            .page = (uint16_t)cell->page,
+        };
+    }
+
+    sprite_atlas_header header = {
+        .magic = SPRITE_ATLAS_MAGIC,
+        .version = SPRITE_ATLAS_VERSION,
+        .page_width = page_w,
+        .page_height = page_h,
+        .page_count = page_count,
+        .source_count = (uint32_t)arrlen(sources),
+        .sprite_count = (uint32_t)arrlen(sprite_cells),
+    };
+
+    FILE* file = fopen(out_path, "wb");
+    if (!file) {
+        fprintf(stderr, "failed to open '%s'\n", out_path);
+        return 1;
+    }
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(pages, sizeof(sprite_atlas_page), header.page_count, file);
+    fwrite(table_sources, sizeof(sprite_atlas_source), header.source_count, file);
+    fwrite(rects, sizeof(sprite_atlas_rect), header.sprite_count, file);
+    fclose(file);
+
+    printf(
+        "%s: %u sprites, %u unique cells, %u page(s) of %ux%u\n",
+        out_path,
+        header.sprite_count,
+        (uint32_t)arrlen(cells),
+        page_count,
+        page_w,
+        page_h);
+
+    return 0;
+}
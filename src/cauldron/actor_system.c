@@ -100,6 +100,28 @@ actor_system_conf config;
 actor_jump_report current_jump_report;
 actor_jump_report* saved_jump_reports = NULL;
 
+// Uniform grid of actor boxes for actor vs actor queries, hashed by cell so only occupied cells
+// take memory. Entries are refreshed every update and only touch the hash when an actor's box
+// moves into a different set of cells.
+#define K_ACTOR_HASH_CELL_SIZE 2.0f
+
+typedef struct actor_hash_cell {
+    uint64_t key;
+    uint32_t* actors; // stbds_arr, actor pool indices
+} actor_hash_cell;
+
+typedef struct actor_hash_entry {
+    actor_handle handle; // invalid while the actor isn't in the hash
+    vec2 min, max;
+    int32_t x0, y0, x1, y1; // cells covered by the box, inclusive
+    uint32_t query_stamp;   // last query that visited the actor, skips actors spanning cells
+} actor_hash_entry;
+
+actor_hash_cell* actor_hash_cells = NULL;    // stbds_hm
+actor_hash_entry* actor_hash_entries = NULL; // stbds_arr, parallel to actor_pool.data
+actor_pair* actor_overlaps = NULL;           // stbds_arr
+uint32_t actor_query_stamp = 0;
+
 // private system interface
 
 void start_jump_report(void);
@@ -109,6 +131,10 @@ void save_last_jump_report(void);
 
 struct actor_move_result actor_calc_move(const actor* actor, const actor_def* actdef, float dt);
 
+void actor_hash_refresh(void);
+void actor_hash_find_overlaps(void);
+void actor_hash_clear(void);
+
 // actor game systems interface implementation
 tx_result actor_system_init(game_settings* settings)
 {
@@ -145,6 +171,10 @@ tx_result actor_system_init(game_settings* settings)
 
 void actor_system_term(void)
 {
+    actor_hash_clear();
+    arrfree(actor_hash_entries);
+    arrfree(actor_overlaps);
+
     hmfree(actor_defs_by_id);
 
     actor_pool_free();
@@ -154,6 +184,7 @@ void actor_system_term(void)
 void actor_system_unload_level(void)
 {
     actor_pool_release_all();
+    actor_hash_clear();
 }
 
 void actor_system_update(float dt)
@@ -238,6 +269,9 @@ void actor_system_update(float dt)
         actor->pos = move_result.new_pos;
         actor->vel = move_result.new_vel;
     }
+
+    actor_hash_refresh();
+    actor_hash_find_overlaps();
 }
 
 struct actor_move_result actor_calc_move(const actor* actor, const actor_def* actdef, float dt)
@@ -246,129 +280,340 @@ struct actor_move_result actor_calc_move(const actor* actor, const actor_def* ac
     const bool was_contact_wall = (actor->flags & ActorFlags_OnWall) != 0;
     const bool was_contact_ceiling = (actor->flags & ActorFlags_OnCeiling) != 0;
 
-    const float max_step_dist = 0.1f;
-    const float solid_scan_dist = 0.01f;
-
-    vec2 total_delta = vec2_scale(actor->vel, dt);
+    vec2 delta = vec2_scale(actor->vel, dt);
     vec2 new_pos = actor->pos;
     vec2 new_vel = actor->vel;
     uint16_t move_flags = ActorMoveResultFlags_None;
-    vec2 remaining_delta = vec2_abs(total_delta);
-    int safety_valve = 1000;
-
-    while ((remaining_delta.x > FLT_EPSILON || remaining_delta.y > FLT_EPSILON)
-           && safety_valve-- > 0) {
-        vec2 dir = vec2_norm(total_delta);
-        float remaining_dist = vec2_len(remaining_delta);
-        float dist_to_travel = fminf(max_step_dist, remaining_dist);
-        vec2 delta = vec2_scale(dir, dist_to_travel);
-
-        // horizontal movement
-        {
-            float check_x = new_pos.x + delta.x + signf(delta.x) * actdef->hsize.x;
-            float bottom = new_pos.y - 0.25f;
-            float top = new_pos.y - actdef->hsize.y * 1.75f;
-            float center = new_pos.y - actdef->hsize.y;
-            if (!phys_solid(check_x, center, 1) /* && !phys_solid(check_x, top, 1)*/) {
-                new_pos.x += delta.x;
-                remaining_delta.x -= fabsf(delta.x);
-            } else {
-                while (!phys_solid(new_pos.x + signf(delta.x) * actdef->hsize.x, center, 1)
-                       /* && !phys_solid(new_pos.x + signf(delta.x) * actor->hsize.x, top, 1) */) {
-                    new_pos.x += signf(delta.x) * solid_scan_dist;
+
+    // horizontal movement, swept at mid height so slopes and steps under the feet don't block it
+    if (delta.x != 0.0f) {
+        float center = new_pos.y - actdef->hsize.y;
+        phys_sweep_hit hit = phys_sweep_aabb(
+            (vec2){.x = new_pos.x - actdef->hsize.x, .y = center},
+            (vec2){.x = new_pos.x + actdef->hsize.x, .y = center},
+            PHYS_AXIS_X,
+            delta.x,
+            1);
+        new_pos.x += hit.dist;
+
+        if (hit.hit) {
+            new_vel.x = 0.0f;
+            move_flags |= ActorMoveResultFlags_StayWall;
+            if (!was_contact_wall) {
+                move_flags |= ActorMoveResultFlags_HitWall;
+            }
+        }
+    }
+
+    // vertical movement
+    {
+        float left = new_pos.x - actdef->hsize.x * 0.95f;
+        float right = new_pos.x + actdef->hsize.x * 0.95f;
+
+        if (delta.y >= 0.0f) {
+            // going down
+            uint16_t ground_mask = (actor->vel.y < 0.0f || actor->platform_timer > 0.0f) ? 1 : 3;
+
+            // grounded actors sweep from above their feet so they step up ledges and follow slopes
+            // they walked into this frame
+            float lift = 0.0f;
+            if (was_contact_ground) {
+                lift = actdef->step_height + fabsf(new_pos.x - actor->pos.x);
+            }
+            float feet = new_pos.y - lift;
+
+            phys_sweep_hit hit = phys_sweep_aabb(
+                (vec2){.x = left, .y = feet},
+                (vec2){.x = right, .y = feet},
+                PHYS_AXIS_Y,
+                delta.y + lift,
+                ground_mask);
+
+            // actors stand on slopes at their center rather than on whichever foot touches first
+            if (hit.hit && hit.shape.type == PHYS_TILE_SHAPE_SLOPE) {
+                hit = phys_sweep_aabb(
+                    (vec2){.x = new_pos.x, .y = feet},
+                    (vec2){.x = new_pos.x, .y = feet},
+                    PHYS_AXIS_Y,
+                    delta.y + lift,
+                    ground_mask);
+            }
+
+            new_pos.y = feet + hit.dist;
+
+            if (hit.hit) {
+                move_flags |= ActorMoveResultFlags_StayGround;
+                if (!was_contact_ground) {
+                    move_flags |= ActorMoveResultFlags_HitGround;
                 }
-                new_vel.x = 0.0f;
-                remaining_delta.x = 0.0f;
-                move_flags |= ActorMoveResultFlags_StayWall;
-                if (!was_contact_wall) {
-                    move_flags |= ActorMoveResultFlags_HitWall;
+            } else if (was_contact_ground && new_vel.y > 0.0f) {
+                new_vel.y = 0.0f;
+            }
+        } else {
+            // going up
+            float top = new_pos.y - actdef->hsize.y * 2.0f;
+            phys_sweep_hit hit = phys_sweep_aabb(
+                (vec2){.x = left, .y = top},
+                (vec2){.x = right, .y = top},
+                PHYS_AXIS_Y,
+                delta.y,
+                1);
+            new_pos.y += hit.dist;
+
+            if (hit.hit) {
+                new_vel.y = 0.0f;
+                move_flags |= ActorMoveResultFlags_StayCeiling;
+                if (!was_contact_ceiling) {
+                    move_flags |= ActorMoveResultFlags_HitCeiling;
                 }
             }
         }
+    }
 
-        // vertical movement
-        {
-            float left = new_pos.x - actdef->hsize.x * 0.95f;
-            float right = new_pos.x + actdef->hsize.x * 0.95f;
-
-            if (delta.y >= 0.0f) {
-                // going down
-                uint16_t ground_mask =
-                    (actor->vel.y < 0.0f || actor->platform_timer > 0.0f) ? 1 : 3;
-                float bottom = new_pos.y;
-                float top = new_pos.y - actdef->hsize.y * 2.0f;
-
-                if (phys_solid(left, bottom + delta.y, ground_mask)
-                    || phys_solid(right, bottom + delta.y, ground_mask)) {
-                    // snap down
-                    while (!phys_solid(left, new_pos.y, ground_mask)
-                           && !phys_solid(right, new_pos.y, ground_mask)) {
-                        new_pos.y += solid_scan_dist;
-                    }
+    if (was_contact_wall && (move_flags & ActorMoveResultFlags_StayWall) == 0) {
+        move_flags |= ActorMoveResultFlags_LeftWall;
+    }
+    if (was_contact_ground && (move_flags & ActorMoveResultFlags_StayGround) == 0) {
+        move_flags |= ActorMoveResultFlags_LeftGround;
+    }
+    if (was_contact_ceiling && (move_flags & ActorMoveResultFlags_StayCeiling) == 0) {
+        move_flags |= ActorMoveResultFlags_LeftCeiling;
+    }
 
-                    // pop up
-                    while (phys_solid(left, new_pos.y - 0.125f, ground_mask)
-                           || phys_solid(right, new_pos.y - 0.125f, ground_mask)
-                           || phys_solid(new_pos.x, new_pos.y, ground_mask)) {
-                        new_pos.y -= solid_scan_dist;
-                    }
+    return (struct actor_move_result){
+        .new_pos = new_pos,
+        .new_vel = new_vel,
+        .flags = move_flags,
+    };
+}
 
-                    remaining_delta.y = 0.0f;
-                    move_flags |= ActorMoveResultFlags_StayGround;
-                    if (!was_contact_ground) {
-                        move_flags |= ActorMoveResultFlags_HitGround;
-                    }
-                } else {
-                    new_pos.y += delta.y;
-                    remaining_delta.y -= fabsf(delta.y);
-                    if (was_contact_ground && new_vel.y > 0.0f) {
-                        new_vel.y = 0.0f;
-                    }
-                }
-            } else {
-                // going up
-                if (phys_solid(left, new_pos.y - delta.y - actdef->hsize.y * 2.0f, 1)
-                    || phys_solid(right, new_pos.y - delta.y - actdef->hsize.y * 2.0f, 1)) {
-
-                    // find contact point
-                    while (!phys_solid(left, new_pos.y - actdef->hsize.y * 2.0f, 1)
-                           && !phys_solid(right, new_pos.y - actdef->hsize.y * 2.0f, 1)) {
-                        new_pos.y -= solid_scan_dist;
-                    }
+static uint64_t actor_hash_key(int32_t x, int32_t y)
+{
+    return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+}
 
-                    new_vel.y = 0.0f;
-                    remaining_delta.y = 0.0f;
-                    move_flags |= ActorMoveResultFlags_StayCeiling;
-                    if (!was_contact_ceiling) {
-                        move_flags |= ActorMoveResultFlags_HitCeiling;
-                    }
-                } else {
-                    new_pos.y += delta.y;
-                    remaining_delta.y -= fabsf(delta.y);
+static int32_t actor_hash_coord(float v)
+{
+    return (int32_t)floorf(v / K_ACTOR_HASH_CELL_SIZE);
+}
+
+static bool boxes_overlap(vec2 min_a, vec2 max_a, vec2 min_b, vec2 max_b)
+{
+    return min_a.x < max_b.x && min_b.x < max_a.x && min_a.y < max_b.y && min_b.y < max_a.y;
+}
+
+static void actor_hash_remove(uint32_t index)
+{
+    actor_hash_entry* entry = &actor_hash_entries[index];
+
+    for (int32_t y = entry->y0; y <= entry->y1; ++y) {
+        for (int32_t x = entry->x0; x <= entry->x1; ++x) {
+            uint64_t key = actor_hash_key(x, y);
+            ptrdiff_t cell_index = hmgeti(actor_hash_cells, key);
+            if (cell_index < 0) {
+                continue;
+            }
+
+            uint32_t** actors = &actor_hash_cells[cell_index].actors;
+            for (int i = 0; i < arrlen(*actors); ++i) {
+                if ((*actors)[i] == index) {
+                    arrdelswap(*actors, i);
+                    break;
                 }
             }
+
+            // drop empty cells so the hash only holds cells with actors in them
+            if (arrlen(*actors) == 0) {
+                arrfree(*actors);
+                hmdel(actor_hash_cells, key);
+            }
         }
+    }
 
-        if (was_contact_wall && (move_flags & ActorMoveResultFlags_StayWall) == 0) {
-            move_flags |= ActorMoveResultFlags_LeftWall;
+    entry->handle = INVALID_HANDLE(actor);
+}
+
+static void actor_hash_insert(uint32_t index)
+{
+    const actor_hash_entry* entry = &actor_hash_entries[index];
+
+    for (int32_t y = entry->y0; y <= entry->y1; ++y) {
+        for (int32_t x = entry->x0; x <= entry->x1; ++x) {
+            uint64_t key = actor_hash_key(x, y);
+            ptrdiff_t cell_index = hmgeti(actor_hash_cells, key);
+            if (cell_index < 0) {
+                hmputs(actor_hash_cells, ((actor_hash_cell){.key = key}));
+                cell_index = hmgeti(actor_hash_cells, key);
+            }
+            arrput(actor_hash_cells[cell_index].actors, index);
         }
-        if (was_contact_ground && (move_flags & ActorMoveResultFlags_StayGround) == 0) {
-            move_flags |= ActorMoveResultFlags_LeftGround;
+    }
+}
+
+void actor_hash_refresh(void)
+{
+    size_t prev_len = arrlen(actor_hash_entries);
+    size_t len = arrlen(actor_pool.data);
+    if (len > prev_len) {
+        arrsetlen(actor_hash_entries, len);
+        memset(actor_hash_entries + prev_len, 0, sizeof(actor_hash_entry) * (len - prev_len));
+    }
+
+    for (uint32_t i = 0; i < (uint32_t)len; ++i) {
+        actor_hash_entry* entry = &actor_hash_entries[i];
+        actor_handle handle = actor_pool.handles[i];
+
+        if (!VALID_HANDLE(handle)) {
+            if (VALID_HANDLE(entry->handle)) {
+                actor_hash_remove(i);
+            }
+            continue;
         }
-        if (was_contact_ceiling && (move_flags & ActorMoveResultFlags_StayCeiling) == 0) {
-            move_flags |= ActorMoveResultFlags_LeftCeiling;
+
+        const actor* actor = &actor_pool.data[i];
+        const actor_def* actdef = actor_def_ptr(actor->h_actor_def);
+
+        // actor positions are at the bottom center of their box
+        vec2 min = {
+            .x = actor->pos.x - actdef->hsize.x,
+            .y = actor->pos.y - actdef->hsize.y * 2.0f,
+        };
+        vec2 max = {.x = actor->pos.x + actdef->hsize.x, .y = actor->pos.y};
+        int32_t x0 = actor_hash_coord(min.x), y0 = actor_hash_coord(min.y);
+        int32_t x1 = actor_hash_coord(max.x), y1 = actor_hash_coord(max.y);
+
+        entry->min = min;
+        entry->max = max;
+
+        // a released index can be reacquired by a new actor before the next refresh
+        if (entry->handle.value == handle.value && entry->x0 == x0 && entry->y0 == y0
+            && entry->x1 == x1 && entry->y1 == y1) {
+            continue;
         }
+
+        if (VALID_HANDLE(entry->handle)) {
+            actor_hash_remove(i);
+        }
+
+        entry->handle = handle;
+        entry->x0 = x0;
+        entry->y0 = y0;
+        entry->x1 = x1;
+        entry->y1 = y1;
+        actor_hash_insert(i);
     }
+}
+
+void actor_hash_find_overlaps(void)
+{
+    arrsetlen(actor_overlaps, 0);
+
+    for (int c = 0; c < hmlen(actor_hash_cells); ++c) {
+        const actor_hash_cell* cell = &actor_hash_cells[c];
 
-    if (safety_valve <= 0) {
-        printf("actor move safety valve limit exceeded.\n");
+        for (int i = 0; i < arrlen(cell->actors); ++i) {
+            const actor_hash_entry* a = &actor_hash_entries[cell->actors[i]];
+
+            for (int j = i + 1; j < arrlen(cell->actors); ++j) {
+                const actor_hash_entry* b = &actor_hash_entries[cell->actors[j]];
+                if (!boxes_overlap(a->min, a->max, b->min, b->max)) {
+                    continue;
+                }
+
+                // pairs sharing several cells are reported by the cell holding the min corner of
+                // their overlap only
+                int32_t x = actor_hash_coord(fmaxf(a->min.x, b->min.x));
+                int32_t y = actor_hash_coord(fmaxf(a->min.y, b->min.y));
+                if (actor_hash_key(x, y) != cell->key) {
+                    continue;
+                }
+
+                arrput(actor_overlaps, ((actor_pair){.a = a->handle, .b = b->handle}));
+            }
+        }
     }
+}
 
-    return (struct actor_move_result){
-        .new_pos = new_pos,
-        .new_vel = new_vel,
-        .flags = move_flags,
-    };
+void actor_hash_clear(void)
+{
+    for (int c = 0; c < hmlen(actor_hash_cells); ++c) {
+        arrfree(actor_hash_cells[c].actors);
+    }
+    hmfree(actor_hash_cells);
+
+    memset(actor_hash_entries, 0, sizeof(actor_hash_entry) * arrlen(actor_hash_entries));
+    arrsetlen(actor_overlaps, 0);
+}
+
+// Visits every actor whose box overlaps [min, max] once, the radius is tested against the box
+// when it's positive.
+static uint32_t actor_hash_query(
+    vec2 min,
+    vec2 max,
+    vec2 center,
+    float radius,
+    actor_handle* out,
+    uint32_t max_out)
+{
+    uint32_t count = 0;
+    uint32_t stamp = ++actor_query_stamp;
+
+    int32_t x0 = actor_hash_coord(min.x), y0 = actor_hash_coord(min.y);
+    int32_t x1 = actor_hash_coord(max.x), y1 = actor_hash_coord(max.y);
+    for (int32_t y = y0; y <= y1; ++y) {
+        for (int32_t x = x0; x <= x1; ++x) {
+            ptrdiff_t cell_index = hmgeti(actor_hash_cells, actor_hash_key(x, y));
+            if (cell_index < 0) {
+                continue;
+            }
+
+            const actor_hash_cell* cell = &actor_hash_cells[cell_index];
+            for (int i = 0; i < arrlen(cell->actors); ++i) {
+                actor_hash_entry* entry = &actor_hash_entries[cell->actors[i]];
+                if (entry->query_stamp == stamp) {
+                    continue;
+                }
+                entry->query_stamp = stamp;
+
+                if (!boxes_overlap(min, max, entry->min, entry->max)) {
+                    continue;
+                }
+
+                if (radius > 0.0f) {
+                    float dx = center.x - clampf(center.x, entry->min.x, entry->max.x);
+                    float dy = center.y - clampf(center.y, entry->min.y, entry->max.y);
+                    if (dx * dx + dy * dy > radius * radius) {
+                        continue;
+                    }
+                }
+
+                if (count == max_out) {
+                    return count;
+                }
+                out[count++] = entry->handle;
+            }
+        }
+    }
+
+    return count;
+}
+
+const actor_pair* actor_get_overlaps(uint32_t* count)
+{
+    *count = (uint32_t)arrlen(actor_overlaps);
+    return actor_overlaps;
+}
+
+uint32_t actor_query_aabb(vec2 min, vec2 max, actor_handle* out, uint32_t max_out)
+{
+    return actor_hash_query(min, max, (vec2){0}, 0.0f, out, max_out);
+}
+
+uint32_t actor_query_radius(vec2 center, float radius, actor_handle* out, uint32_t max_out)
+{
+    vec2 min = {.x = center.x - radius, .y = center.y - radius};
+    vec2 max = {.x = center.x + radius, .y = center.y + radius};
+    return actor_hash_query(min, max, center, radius, out, max_out);
 }
 
 void start_jump_report(void)
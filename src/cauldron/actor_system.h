@@ -53,6 +53,12 @@ DEFINE_HANDLE(actor);
 POOL_FORWARD(actor);
 POOL_FORWARD(actor_def);
 
+// two actors whose boxes overlap
+typedef struct actor_pair {
+    actor_handle a;
+    actor_handle b;
+} actor_pair;
+
 typedef struct actor_desc {
     actor_def_handle h_actor_def;
     vec2 pos;
@@ -69,6 +75,12 @@ actor_def_handle actor_def_get_name(char* name);
 actor_def_handle actor_def_get_id(strhash name_id);
 void actor_def_editor_window(bool* show);
 
+// Actor vs actor queries go through a spatial hash of actor boxes refreshed at the end of
+// actor_system_update, so they see actors where they were after the last update.
+const actor_pair* actor_get_overlaps(uint32_t* count); // each overlapping pair listed once
+uint32_t actor_query_aabb(vec2 min, vec2 max, actor_handle* out, uint32_t max_out);
+uint32_t actor_query_radius(vec2 center, float radius, actor_handle* out, uint32_t max_out);
+
 // game systems interface
 
 tx_result actor_system_init(game_settings* settings);
@@ -6,6 +6,7 @@
 #include "event_system.h"
 #include "game_level.h"
 #include "hash.h"
+#include "level_cache.h"
 #include <stb_ds.h>
 
 typedef void (*spawn_entity_proc)(entity_desc*);
@@ -17,6 +18,16 @@ typedef struct entity_spawn_data {
 
 entity_spawn_data* ent_spawn_data = NULL;
 
+// a level's entity definitions with their spawn procs already looked up, cached per level
+typedef struct entity_spawn {
+    game_ent_def_inst* ent_def;
+    spawn_entity_proc spawn_proc;
+} entity_spawn;
+
+typedef struct entity_spawn_list {
+    entity_spawn* spawns; // stbds_arr
+} entity_spawn_list;
+
 void spawn_entity_player_spawn(entity_desc* desc)
 {
     game_ent_def_inst* ent_def = desc->ent_def;
@@ -63,11 +74,47 @@ void spawn_entity(entity_desc* desc)
     }
 }
 
+static void* build_spawn_list(const game_level* level, size_t* bytes)
+{
+    entity_spawn_list* list = calloc(1, sizeof(entity_spawn_list));
+
+    for (uint32_t i = 0; i < level->layer_count; ++i) {
+        const game_layer_inst* layer = &level->layer_insts[i];
+        if (layer->type != GAME_LAYER_TYPE_ENTITIES) {
+            continue;
+        }
+
+        for (uint32_t j = 0; j < layer->ent_count; ++j) {
+            entity_spawn_data spawn_data = hmgets(ent_spawn_data, layer->ents[j].id);
+            if (spawn_data.spawn_proc) {
+                arrput(
+                    list->spawns,
+                    ((entity_spawn){
+                        .ent_def = &layer->ents[j],
+                        .spawn_proc = spawn_data.spawn_proc,
+                    }));
+            }
+        }
+    }
+
+    *bytes = sizeof(entity_spawn_list) + sizeof(entity_spawn) * arrlen(list->spawns);
+    return list;
+}
+
+static void free_spawn_list(void* data)
+{
+    entity_spawn_list* list = (entity_spawn_list*)data;
+    arrfree(list->spawns);
+    free(list);
+}
+
 tx_result entity_system_init(game_settings* settings)
 {
     register_entity("player_01", spawn_entity_player_spawn);
     register_entity("enemy_01", spawn_entity_enemy_01_spawn);
 
+    level_cache_register(LEVEL_CACHE_SLOT_SPAWNS, build_spawn_list, free_spawn_list);
+
     return TX_SUCCESS;
 }
 
@@ -78,17 +125,10 @@ void entity_system_term(void)
 
 void entity_system_load_level(game_level* level)
 {
-    uint32_t ent_player_spawn = hash_string("player_01");
-    uint32_t ent_en01_spawn = hash_string("enemy_01");
-
-    for (int i = 0; i < arrlen(level->layer_insts); ++i) {
-        game_layer_inst* layer = &level->layer_insts[i];
-        if (layer->type == GAME_LAYER_TYPE_ENTITIES) {
-            for (int j = 0; j < arrlen(layer->ents); ++j) {
-                game_ent_def_inst* ent_def = &layer->ents[j];
-                spawn_entity(&(entity_desc){.ent_def = ent_def});
-            }
-        }
+    const entity_spawn_list* list = level_cache_acquire(level, LEVEL_CACHE_SLOT_SPAWNS);
+
+    for (int i = 0; i < arrlen(list->spawns); ++i) {
+        list->spawns[i].spawn_proc(&(entity_desc){.ent_def = list->spawns[i].ent_def});
     }
 }
 
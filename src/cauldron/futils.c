@@ -2,8 +2,20 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 
-enum tx_result read_file_to_buffer(const char* filename, char** buffer, size_t* len)
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static enum tx_result
+read_to_buffer(const char* filename, const char* mode, char** buffer, size_t* len)
 {
     if (!(buffer && len)) {
         return TX_INVALID_PARAMTER;
@@ -11,7 +23,7 @@ enum tx_result read_file_to_buffer(const char* filename, char** buffer, size_t*
 
     enum tx_result result = TX_INVALID;
     size_t string_size = 0, read_size = 0;
-    FILE* file = fopen(filename, "r");
+    FILE* file = fopen(filename, mode);
 
     if (file) {
         fseek(file, 0, SEEK_END);
@@ -37,6 +49,7 @@ enum tx_result read_file_to_buffer(const char* filename, char** buffer, size_t*
         *buffer = mem;
         *len = read_size;
 
+        fclose(file);
         return TX_SUCCESS;
     } else {
         return TX_FILE_ERROR;
@@ -46,3 +59,120 @@ exit:
     fclose(file);
     return result;
 }
+
+enum tx_result read_file_to_buffer(const char* filename, char** buffer, size_t* len)
+{
+    return read_to_buffer(filename, "r", buffer, len);
+}
+
+enum tx_result read_binary_file_to_buffer(const char* filename, uint8_t** buffer, size_t* len)
+{
+    return read_to_buffer(filename, "rb", (char**)buffer, len);
+}
+
+#ifdef _WIN32
+enum tx_result map_file(const char* filename, file_map* map)
+{
+    if (!(filename && map)) {
+        return TX_INVALID_PARAMTER;
+    }
+
+    *map = (file_map){0};
+
+    HANDLE file = CreateFileA(
+        filename,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return TX_FILE_ERROR;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return TX_FILE_ERROR;
+    }
+
+    // the view keeps the mapping and the mapping keeps the file open
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        return TX_FILE_ERROR;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) {
+        return TX_FILE_ERROR;
+    }
+
+    map->data = (uint8_t*)data;
+    map->size = (size_t)size.QuadPart;
+    return TX_SUCCESS;
+}
+
+void unmap_file(file_map* map)
+{
+    if (map && map->data) {
+        UnmapViewOfFile(map->data);
+        *map = (file_map){0};
+    }
+}
+#else
+enum tx_result map_file(const char* filename, file_map* map)
+{
+    if (!(filename && map)) {
+        return TX_INVALID_PARAMTER;
+    }
+
+    *map = (file_map){0};
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return TX_FILE_ERROR;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return TX_FILE_ERROR;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return TX_FILE_ERROR;
+    }
+
+    map->data = (uint8_t*)data;
+    map->size = (size_t)st.st_size;
+    return TX_SUCCESS;
+}
+
+void unmap_file(file_map* map)
+{
+    if (map && map->data) {
+        munmap(map->data, map->size);
+        *map = (file_map){0};
+    }
+}
+#endif
+
+enum tx_result get_file_mtime(const char* filename, int64_t* mtime)
+{
+    if (!(filename && mtime)) {
+        return TX_INVALID_PARAMTER;
+    }
+
+    struct stat st;
+    if (stat(filename, &st) != 0) {
+        return TX_FILE_ERROR;
+    }
+
+    *mtime = (int64_t)st.st_mtime;
+    return TX_SUCCESS;
+}
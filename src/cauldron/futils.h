@@ -6,3 +6,18 @@
 #include "tx_types.h"
 
 enum tx_result read_file_to_buffer(const char* filename, char** buffer, size_t* len);
+
+// same as read_file_to_buffer without newline translation, the buffer is still null terminated
+enum tx_result read_binary_file_to_buffer(const char* filename, uint8_t** buffer, size_t* len);
+
+// Private copy-on-write mapping of a whole file, writes to the mapping never reach the file.
+typedef struct file_map {
+    uint8_t* data;
+    size_t size;
+} file_map;
+
+enum tx_result map_file(const char* filename, file_map* map);
+void unmap_file(file_map* map);
+
+// last modification time in seconds since the epoch
+enum tx_result get_file_mtime(const char* filename, int64_t* mtime);
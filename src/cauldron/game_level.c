@@ -1,20 +1,35 @@
 #include "game_level.h"
 
 #include "futils.h"
+#include "game_level_pack.h"
 #include "hash.h"
 #include "jsonutil.h"
 #include "profile.h"
+#include <SDL2/SDL.h>
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-tx_result parse_level(const char* js, jsmntok_t* tokens, int tok_id, game_level* out);
-tx_result parse_layer_instance(const char* js, jsmntok_t* tokens, int tok_id, game_layer_inst* out);
-tx_result parse_entity_layer(const char* js, jsmntok_t* tokens, int tok_id, game_layer_inst* out);
-tx_result parse_tile_layer(const char* js, jsmntok_t* tokens, int tok_id, game_layer_inst* out);
-tx_result parse_int_grid_layer(const char* js, jsmntok_t* tokens, int tok_id, game_layer_inst* out);
-tx_result parse_auto_layer(const char* js, jsmntok_t* tokens, int tok_id, game_layer_inst* out);
+typedef struct layer_parse_job {
+    int tok_id;
+    game_layer_inst* out;
+} layer_parse_job;
+
+// Layers are independent once the document is tokenized so they are parsed as jobs, pulled off the
+// queue by every parsing thread until it is empty.
+typedef struct layer_parse_queue {
+    const jsdoc* doc;
+    layer_parse_job* jobs; // stbds_arr
+    SDL_atomic_t next;
+} layer_parse_queue;
+
+tx_result parse_level(const jsdoc* doc, int tok_id, game_level* out, layer_parse_queue* queue);
+tx_result parse_layer_instance(const jsdoc* doc, int tok_id, game_layer_inst* out);
+tx_result parse_entity_layer(const jsdoc* doc, int tok_id, game_layer_inst* out);
+tx_result parse_tile_layer(const jsdoc* doc, int tok_id, game_layer_inst* out);
+tx_result parse_int_grid_layer(const jsdoc* doc, int tok_id, game_layer_inst* out);
+tx_result parse_auto_layer(const jsdoc* doc, int tok_id, game_layer_inst* out);
 
 game_layer_source_type js_game_layer_type(const char* js, jsmntok_t token);
 
@@ -30,7 +45,9 @@ tx_result load_game_level_project(const char* filename, game_level_proj* proj)
         return result;
     }
 
-    result = parse_game_level_project(js, len, proj);
+    // leave a core to the main thread, projects are reloaded while the game keeps running
+    int threads = SDL_GetCPUCount() - 1;
+    result = parse_game_level_project_jobs(js, len, proj, (threads > 1) ? threads : 1);
 
     uint64_t time = profile_stop("load_game_level_project");
 
@@ -41,10 +58,13 @@ tx_result load_game_level_project(const char* filename, game_level_proj* proj)
 
 tx_result free_game_level_project(game_level_proj* proj)
 {
+    // tiles and ents of a pack live in the mapping
+    bool mapped = proj->pack.data != NULL;
+
     if (proj->levels) {
         for (int i = 0; i < arrlen(proj->levels); ++i) {
             game_level* level = &proj->levels[i];
-            if (level->layer_insts) {
+            if (level->layer_insts && !mapped) {
                 for (int j = 0; j < arrlen(level->layer_insts); ++j) {
                     game_layer_inst* layer = &level->layer_insts[j];
                     arrfree(layer->tiles);
@@ -55,9 +75,316 @@ tx_result free_game_level_project(game_level_proj* proj)
         }
     }
     arrfree(proj->levels);
+    proj->level_count = 0;
+    unmap_file(&proj->pack);
     return TX_SUCCESS;
 }
 
+// strhash value -> string table index
+typedef struct pack_string_entry {
+    uint32_t key;
+    uint32_t value;
+} pack_string_entry;
+
+typedef struct pack_strings {
+    pack_string_entry* lookup; // stbds_hm
+    strhash* table;            // stbds_arr
+} pack_strings;
+
+static uint32_t pack_string_index(pack_strings* strings, strhash str)
+{
+    ptrdiff_t found = hmgeti(strings->lookup, str.value);
+    if (found >= 0) {
+        return strings->lookup[found].value;
+    }
+
+    uint32_t index = (uint32_t)arrlen(strings->table);
+    arrput(strings->table, str);
+    hmput(strings->lookup, str.value, index);
+    return index;
+}
+
+static uint32_t align4(uint32_t offset)
+{
+    return (offset + 3) & ~3u;
+}
+
+tx_result save_game_level_pack(const char* filename, const game_level_proj* proj)
+{
+    if (!(filename && proj)) {
+        return TX_INVALID_PARAMTER;
+    }
+
+    pack_strings strings = {0};
+    game_level_pack_level* levels = NULL; // stbds_arr
+    game_level_pack_layer* layers = NULL; // stbds_arr
+    game_level_pack_ent* ents = NULL;     // stbds_arr, every layer's entities back to back
+
+    for (uint32_t i = 0; i < proj->level_count; ++i) {
+        const game_level* level = &proj->levels[i];
+        game_level_pack_level pack_level = {
+            .name = pack_string_index(&strings, level->name_id),
+            .first_layer = (uint32_t)arrlen(layers),
+            .layer_count = level->layer_count,
+            .uid = level->uid,
+            .neighbour_count = level->neighbour_count,
+        };
+        memcpy(pack_level.neighbours, level->neighbours, sizeof(level->neighbours));
+        arrput(levels, pack_level);
+
+        for (uint32_t j = 0; j < level->layer_count; ++j) {
+            const game_layer_inst* layer = &level->layer_insts[j];
+            arrput(
+                layers,
+                ((game_level_pack_layer){
+                    .type = (uint32_t)layer->type,
+                    .cell_w = layer->cell_w,
+                    .cell_h = layer->cell_h,
+                    .cell_size = layer->cell_size,
+                    .tile_count = layer->tile_count,
+                    .ent_count = layer->ent_count,
+                }));
+
+            for (uint32_t k = 0; k < layer->ent_count; ++k) {
+                arrput(
+                    ents,
+                    ((game_level_pack_ent){
+                        .id = pack_string_index(&strings, layer->ents[k].id),
+                        .world_x = layer->ents[k].world_x,
+                        .world_y = layer->ents[k].world_y,
+                    }));
+            }
+        }
+    }
+
+    uint32_t string_ct = (uint32_t)arrlen(strings.table);
+    game_level_pack_string* pack_strings = calloc(string_ct + 1, sizeof(game_level_pack_string));
+
+    // lay out the data sections after the tables
+    uint32_t offset = sizeof(game_level_pack_header)
+                      + sizeof(game_level_pack_level) * (uint32_t)arrlen(levels)
+                      + sizeof(game_level_pack_layer) * (uint32_t)arrlen(layers)
+                      + sizeof(game_level_pack_string) * string_ct;
+    for (int i = 0; i < arrlen(layers); ++i) {
+        layers[i].tiles_offset = offset;
+        offset = align4(offset + sizeof(game_tile) * layers[i].tile_count);
+        layers[i].ents_offset = offset;
+        offset += sizeof(game_level_pack_ent) * layers[i].ent_count;
+    }
+    for (uint32_t i = 0; i < string_ct; ++i) {
+        pack_strings[i].offset = offset;
+        pack_strings[i].len = (uint32_t)strlen(strhash_cstr(strings.table[i]));
+        offset += pack_strings[i].len + 1;
+    }
+
+    tx_result ret = TX_SUCCESS;
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        ret = TX_FILE_ERROR;
+        goto exit;
+    }
+
+    game_level_pack_header header = {
+        .magic = GAME_LEVEL_PACK_MAGIC,
+        .version = GAME_LEVEL_PACK_VERSION,
+        .level_count = (uint32_t)arrlen(levels),
+        .layer_count = (uint32_t)arrlen(layers),
+        .string_count = string_ct,
+    };
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(levels, sizeof(game_level_pack_level), arrlen(levels), file);
+    fwrite(layers, sizeof(game_level_pack_layer), arrlen(layers), file);
+    fwrite(pack_strings, sizeof(game_level_pack_string), string_ct, file);
+
+    // layers are visited in the same order as they were laid out
+    const uint8_t zeros[4] = {0};
+    const game_level_pack_ent* next_ents = ents;
+    uint32_t layer_index = 0;
+    for (uint32_t i = 0; i < proj->level_count; ++i) {
+        const game_level* level = &proj->levels[i];
+        for (uint32_t j = 0; j < level->layer_count; ++j, ++layer_index) {
+            const game_layer_inst* layer = &level->layer_insts[j];
+            fwrite(layer->tiles, sizeof(game_tile), layer->tile_count, file);
+            uint32_t tiles_end = layers[layer_index].tiles_offset
+                                 + sizeof(game_tile) * layer->tile_count;
+            fwrite(zeros, 1, layers[layer_index].ents_offset - tiles_end, file);
+            fwrite(next_ents, sizeof(game_level_pack_ent), layer->ent_count, file);
+            next_ents += layer->ent_count;
+        }
+    }
+
+    for (uint32_t i = 0; i < string_ct; ++i) {
+        fwrite(strhash_cstr(strings.table[i]), 1, pack_strings[i].len + 1, file);
+    }
+
+    if (ferror(file)) {
+        ret = TX_FILE_ERROR;
+    }
+    fclose(file);
+
+exit:
+    free(pack_strings);
+    arrfree(ents);
+    arrfree(layers);
+    arrfree(levels);
+    arrfree(strings.table);
+    hmfree(strings.lookup);
+    return ret;
+}
+
+static bool pack_range_valid(const file_map* pack, uint64_t offset, uint64_t size, uint32_t align)
+{
+    return (offset % align) == 0 && offset + size <= pack->size;
+}
+
+tx_result load_game_level_pack(const char* filename, game_level_proj* proj)
+{
+    // entities are used in place as game_ent_def_inst
+    TX_ASSERT(sizeof(game_level_pack_ent) == sizeof(game_ent_def_inst));
+    TX_ASSERT(sizeof(game_tile) == 4);
+
+    memset(proj, 0, sizeof(game_level_proj));
+
+    profile_start("load_game_level_pack");
+
+    tx_result ret = map_file(filename, &proj->pack);
+    if (ret != TX_SUCCESS) {
+        goto fail;
+    }
+
+    const file_map* pack = &proj->pack;
+    const game_level_pack_header* header = (const game_level_pack_header*)pack->data;
+    if (pack->size < sizeof(game_level_pack_header) || header->magic != GAME_LEVEL_PACK_MAGIC
+        || header->version != GAME_LEVEL_PACK_VERSION) {
+        ret = TX_PARSE_ERROR;
+        goto fail;
+    }
+
+    uint64_t levels_offset = sizeof(game_level_pack_header);
+    uint64_t layers_offset =
+        levels_offset + sizeof(game_level_pack_level) * (uint64_t)header->level_count;
+    uint64_t strings_offset =
+        layers_offset + sizeof(game_level_pack_layer) * (uint64_t)header->layer_count;
+    uint64_t strings_size = sizeof(game_level_pack_string) * (uint64_t)header->string_count;
+    if (!pack_range_valid(pack, strings_offset, strings_size, 4)) {
+        ret = TX_PARSE_ERROR;
+        goto fail;
+    }
+
+    const game_level_pack_level* levels =
+        (const game_level_pack_level*)(pack->data + levels_offset);
+    const game_level_pack_layer* layers =
+        (const game_level_pack_layer*)(pack->data + layers_offset);
+    const game_level_pack_string* strings =
+        (const game_level_pack_string*)(pack->data + strings_offset);
+
+    // the only work proportional to the pack is interning its handful of strings
+    strhash* ids = NULL; // stbds_arr
+    arrsetlen(ids, header->string_count);
+    for (uint32_t i = 0; i < header->string_count; ++i) {
+        if (!pack_range_valid(pack, strings[i].offset, strings[i].len + 1ull, 1)) {
+            ret = TX_PARSE_ERROR;
+            goto fail_strings;
+        }
+        ids[i] = strhash_get_len((const char*)pack->data + strings[i].offset, (int)strings[i].len);
+    }
+
+    proj->level_count = header->level_count;
+    arrsetlen(proj->levels, header->level_count);
+    memset(proj->levels, 0, sizeof(game_level) * header->level_count);
+
+    for (uint32_t i = 0; i < header->level_count; ++i) {
+        const game_level_pack_level* src = &levels[i];
+        game_level* level = &proj->levels[i];
+        if (src->name >= header->string_count
+            || (uint64_t)src->first_layer + src->layer_count > header->layer_count
+            || src->neighbour_count > GAME_LEVEL_MAX_NEIGHBOURS) {
+            ret = TX_PARSE_ERROR;
+            goto fail_strings;
+        }
+
+        level->name_id = ids[src->name];
+        level->layer_count = src->layer_count;
+        level->uid = src->uid;
+        for (uint32_t n = 0; n < src->neighbour_count; ++n) {
+            if (src->neighbours[n] < header->level_count) {
+                level->neighbours[level->neighbour_count++] = src->neighbours[n];
+            }
+        }
+        arrsetlen(level->layer_insts, src->layer_count);
+
+        for (uint32_t j = 0; j < src->layer_count; ++j) {
+            const game_level_pack_layer* layer = &layers[src->first_layer + j];
+            uint64_t tiles_size = sizeof(game_tile) * (uint64_t)layer->tile_count;
+            uint64_t ents_size = sizeof(game_level_pack_ent) * (uint64_t)layer->ent_count;
+            if (!pack_range_valid(pack, layer->tiles_offset, tiles_size, 4)
+                || !pack_range_valid(pack, layer->ents_offset, ents_size, 4)) {
+                ret = TX_PARSE_ERROR;
+                goto fail_strings;
+            }
+
+            // grid layers are indexed by cell coordinates so they must cover every cell
+            bool grid_layer =
+                layer->type == GAME_LAYER_TYPE_TILES || layer->type == GAME_LAYER_TYPE_INTGRID;
+            if (grid_layer && layer->tile_count != (uint64_t)layer->cell_w * layer->cell_h) {
+                ret = TX_PARSE_ERROR;
+                goto fail_strings;
+            }
+
+            // swap string indices for strhashes, only these pages get copied on write
+            game_ent_def_inst* ents = (game_ent_def_inst*)(pack->data + layer->ents_offset);
+            for (uint32_t k = 0; k < layer->ent_count; ++k) {
+                uint32_t name = ents[k].id.value;
+                ents[k].id = (name < header->string_count) ? ids[name] : (strhash){0};
+            }
+
+            level->layer_insts[j] = (game_layer_inst){
+                .type = (game_layer_type)layer->type,
+                .cell_w = layer->cell_w,
+                .cell_h = layer->cell_h,
+                .cell_size = layer->cell_size,
+                .tile_count = layer->tile_count,
+                .ent_count = layer->ent_count,
+                .tiles = (game_tile*)(pack->data + layer->tiles_offset),
+                .ents = ents,
+            };
+        }
+
+        // physics reads the first tile layer with the dimensions of the first intgrid layer
+        const game_layer_inst* intgrid_layer = NULL;
+        const game_layer_inst* tile_layer = NULL;
+        for (uint32_t j = 0; j < level->layer_count; ++j) {
+            const game_layer_inst* layer = &level->layer_insts[j];
+            if (!intgrid_layer && layer->type == GAME_LAYER_TYPE_INTGRID) {
+                intgrid_layer = layer;
+            }
+            if (!tile_layer && layer->type == GAME_LAYER_TYPE_TILES) {
+                tile_layer = layer;
+            }
+        }
+        if (intgrid_layer && tile_layer
+            && (intgrid_layer->cell_w != tile_layer->cell_w
+                || intgrid_layer->cell_h != tile_layer->cell_h)) {
+            ret = TX_PARSE_ERROR;
+            goto fail_strings;
+        }
+    }
+
+    arrfree(ids);
+
+    uint64_t time = profile_stop("load_game_level_pack");
+    printf("Loading game level pack from '%s' took %llums.\n", filename, time);
+
+    return TX_SUCCESS;
+
+fail_strings:
+    arrfree(ids);
+fail:
+    profile_stop("load_game_level_pack");
+    free_game_level_project(proj);
+    return ret;
+}
+
 game_layer_source_type js_game_layer_type(const char* js, jsmntok_t token)
 {
     if (jseq(js, token, "Tiles")) {
@@ -73,7 +400,67 @@ game_layer_source_type js_game_layer_type(const char* js, jsmntok_t token)
     }
 }
 
+static int layer_parse_worker(void* data)
+{
+    layer_parse_queue* queue = (layer_parse_queue*)data;
+    int count = (int)arrlen(queue->jobs);
+    for (int i = SDL_AtomicAdd(&queue->next, 1); i < count; i = SDL_AtomicAdd(&queue->next, 1)) {
+        parse_layer_instance(queue->doc, queue->jobs[i].tok_id, queue->jobs[i].out);
+    }
+    return 0;
+}
+
+// Runs every queued layer job on up to `threads` threads including the calling one.
+static void run_layer_parse_jobs(layer_parse_queue* queue, int threads)
+{
+    // threads are started and joined on every load, keep their count modest
+    enum { MAX_PARSE_THREADS = 8 };
+
+    int count = (int)arrlen(queue->jobs);
+    threads = (threads < count) ? threads : count;
+    threads = (threads < MAX_PARSE_THREADS) ? threads : MAX_PARSE_THREADS;
+
+    SDL_Thread* workers[MAX_PARSE_THREADS];
+    int worker_ct = 0;
+    for (int i = 1; i < threads; ++i) {
+        SDL_Thread* worker = SDL_CreateThread(layer_parse_worker, "level parse", queue);
+        if (worker) {
+            workers[worker_ct++] = worker;
+        }
+    }
+
+    layer_parse_worker(queue);
+
+    for (int i = 0; i < worker_ct; ++i) {
+        SDL_WaitThread(workers[i], NULL);
+    }
+}
+
 tx_result parse_game_level_project(const char* js, size_t len, game_level_proj* proj)
+{
+    return parse_game_level_project_jobs(js, len, proj, 1);
+}
+
+// neighbours are parsed as uids, turn them into level indices and drop any that don't exist
+static void resolve_level_neighbours(game_level_proj* proj)
+{
+    for (uint32_t i = 0; i < proj->level_count; ++i) {
+        game_level* level = &proj->levels[i];
+        uint32_t count = 0;
+        for (uint32_t n = 0; n < level->neighbour_count; ++n) {
+            for (uint32_t j = 0; j < proj->level_count; ++j) {
+                if (j != i && proj->levels[j].uid == (int32_t)level->neighbours[n]) {
+                    level->neighbours[count++] = j;
+                    break;
+                }
+            }
+        }
+        level->neighbour_count = count;
+    }
+}
+
+tx_result
+parse_game_level_project_jobs(const char* js, size_t len, game_level_proj* proj, int threads)
 {
     // to keep ourselves sane we will just memset every structure to zero throughout the whole tree
     // of data so that it's easier to identify which pointers need to be freed
@@ -81,15 +468,8 @@ tx_result parse_game_level_project(const char* js, size_t len, game_level_proj*
 
     tx_result ret = TX_SUCCESS;
 
-    jsmn_parser parser;
-    jsmn_init(&parser);
-
-    int tok_needed = jsmn_parse(&parser, js, len, NULL, 0);
-    jsmntok_t* tokens = NULL;
-    arrsetlen(tokens, tok_needed);
-
-    jsmn_init(&parser);
-    int tok_len = jsmn_parse(&parser, js, len, tokens, tok_needed);
+    jsdoc doc;
+    int tok_len = jsdoc_parse(&doc, js, len);
 
     if (tok_len < 0) {
         ret = TX_PARSE_ERROR;
@@ -97,44 +477,66 @@ tx_result parse_game_level_project(const char* js, size_t len, game_level_proj*
     }
 
     int levels_find = -1;
-    for (int i = 1; i < tok_len; i = jsnextsib(tokens, i)) {
-        jsmntok_t token = tokens[i];
+    for (int i = 1; i < tok_len; i = jsnextsib(&doc, i)) {
+        jsmntok_t token = doc.tokens[i];
 
-        if (jseq(js, token, "levels") && tokens[i + 1].type == JSMN_ARRAY) {
+        if (jseq(js, token, "levels") && doc.tokens[i + 1].type == JSMN_ARRAY) {
             levels_find = i + 1;
             break;
         }
     }
 
     if (levels_find >= 0) {
-        size_t levels_len = tokens[levels_find].size;
+        // levels are cheap to set up and intern their names so only their layers are jobs
+        layer_parse_queue queue = {.doc = &doc};
+
+        size_t levels_len = doc.tokens[levels_find].size;
         arrsetlen(proj->levels, levels_len);
+        proj->level_count = (uint32_t)levels_len;
         int level_tok_id = levels_find + 1;
         for (int i = 0; i < levels_len; ++i) {
-            parse_level(js, tokens, level_tok_id, &proj->levels[i]);
-            level_tok_id = jsnextsib(tokens, level_tok_id);
+            parse_level(&doc, level_tok_id, &proj->levels[i], &queue);
+            level_tok_id = jsnextsib(&doc, level_tok_id);
         }
+        resolve_level_neighbours(proj);
+
+        run_layer_parse_jobs(&queue, threads);
+        arrfree(queue.jobs);
     }
 
 exit:
-    arrfree(tokens);
+    jsdoc_free(&doc);
     return ret;
 }
 
-tx_result parse_level(const char* js, jsmntok_t* tokens, int tok_id, game_level* out)
+// Sizes the level's layer array and queues its layer instances, which are parsed later.
+tx_result parse_level(const jsdoc* doc, int tok_id, game_level* out, layer_parse_queue* queue)
 {
     memset(out, 0, sizeof(game_level));
 
-    jsmntok_t name_tok = jsget(js, tokens, tok_id, "identifier");
-    out->name_id = strhash_get_len(js + name_tok.start, name_tok.end - name_tok.start);
+    jsmntok_t name_tok = jsget(doc, tok_id, "identifier");
+    out->name_id = strhash_get_len(doc->js + name_tok.start, name_tok.end - name_tok.start);
+    out->uid = jstoi_or(doc->js, jsget(doc, tok_id, "uid"), -1);
+
+    // only written by newer LDtk versions, uids until resolve_level_neighbours
+    int neighbours_id = jsget_id(doc, tok_id, "__neighbours");
+    if (neighbours_id >= 0 && doc->tokens[neighbours_id].type == JSMN_ARRAY) {
+        int end = jsnextsib(doc, neighbours_id);
+        for (int i = neighbours_id + 1; i < end; i = jsnextsib(doc, i)) {
+            int uid = jstoi_or(doc->js, jsget(doc, i, "levelUid"), -1);
+            if (uid >= 0 && out->neighbour_count < GAME_LEVEL_MAX_NEIGHBOURS) {
+                out->neighbours[out->neighbour_count++] = (uint32_t)uid;
+            }
+        }
+    }
 
-    int layer_inst_id = jsget_id(js, tokens, tok_id, "layerInstances");
+    int layer_inst_id = jsget_id(doc, tok_id, "layerInstances");
 
     if (layer_inst_id < 0) {
         return TX_INVALID;
     }
 
-    jsmntok_t layer_inst_tok = tokens[layer_inst_id];
+    jsmntok_t layer_inst_tok = doc->tokens[layer_inst_id];
 
     if (layer_inst_tok.type != JSMN_ARRAY) {
         return TX_INVALID;
@@ -142,47 +544,50 @@ tx_result parse_level(const char* js, jsmntok_t* tokens, int tok_id, game_level*
 
     size_t layer_insts_size = layer_inst_tok.size;
     arrsetlen(out->layer_insts, layer_insts_size);
+    out->layer_count = (uint32_t)layer_insts_size;
 
     int layer_tok_id = layer_inst_id + 1;
     for (size_t i = 0; i < layer_insts_size; ++i) {
-        parse_layer_instance(js, tokens, layer_tok_id, &out->layer_insts[i]);
-        layer_tok_id = jsnextsib(tokens, layer_tok_id);
+        arrput(
+            queue->jobs,
+            ((layer_parse_job){
+                .tok_id = layer_tok_id,
+                .out = &out->layer_insts[i],
+            }));
+        layer_tok_id = jsnextsib(doc, layer_tok_id);
     }
 
     return TX_SUCCESS;
 }
 
-tx_result parse_layer_instance(const char* js, jsmntok_t* tokens, int tok_id, game_layer_inst* out)
+tx_result parse_layer_instance(const jsdoc* doc, int tok_id, game_layer_inst* out)
 {
     memset(out, 0, sizeof(game_layer_inst));
 
-    game_layer_source_type sourceType = js_game_layer_type(js, jsget(js, tokens, tok_id, "__type"));
+    game_layer_source_type sourceType =
+        js_game_layer_type(doc->js, jsget(doc, tok_id, "__type"));
 
     switch (sourceType) {
     case GAME_LAYER_SOURCE_TYPE_TILES:
-        printf("Parsing tile layer...\n");
-        return parse_tile_layer(js, tokens, tok_id, out);
+        return parse_tile_layer(doc, tok_id, out);
     case GAME_LAYER_SOURCE_TYPE_INTGRID:
-        printf("Parsing intgrid layer...\n");
-        return parse_int_grid_layer(js, tokens, tok_id, out);
+        return parse_int_grid_layer(doc, tok_id, out);
     case GAME_LAYER_SOURCE_TYPE_ENTITIES:
-        printf("Parsing entity layer...\n");
-        return parse_entity_layer(js, tokens, tok_id, out);
+        return parse_entity_layer(doc, tok_id, out);
     case GAME_LAYER_SOURCE_TYPE_AUTOLAYER:
-        printf("Parsing autolayer layer...\n");
-        return parse_auto_layer(js, tokens, tok_id, out);
+        return parse_auto_layer(doc, tok_id, out);
     default:
         return TX_INVALID;
     }
 }
 
-tx_result parse_tile_layer(const char* js, jsmntok_t* tokens, int tok_id, game_layer_inst* out)
+tx_result parse_tile_layer(const jsdoc* doc, int tok_id, game_layer_inst* out)
 {
     out->type = GAME_LAYER_TYPE_TILES;
-    out->cell_w = jstoi_or(js, jsget(js, tokens, tok_id, "__cWid"), 0);
-    out->cell_h = jstoi_or(js, jsget(js, tokens, tok_id, "__cHei"), 0);
-    out->cell_size = jstoi_or(js, jsget(js, tokens, tok_id, "__gridSize"), 0);
-    int grid_tiles_id = jsget_id(js, tokens, tok_id, "gridTiles");
+    out->cell_w = jstoi_or(doc->js, jsget(doc, tok_id, "__cWid"), 0);
+    out->cell_h = jstoi_or(doc->js, jsget(doc, tok_id, "__cHei"), 0);
+    out->cell_size = jstoi_or(doc->js, jsget(doc, tok_id, "__gridSize"), 0);
+    int grid_tiles_id = jsget_id(doc, tok_id, "gridTiles");
 
     if (out->cell_size == 0 || grid_tiles_id < 0) {
         return TX_INVALID;
@@ -191,15 +596,16 @@ tx_result parse_tile_layer(const char* js, jsmntok_t* tokens, int tok_id, game_l
     size_t tiles_size = out->cell_w * out->cell_h;
     arrsetlen(out->tiles, tiles_size);
     memset(out->tiles, 0, sizeof(game_tile) * tiles_size);
+    out->tile_count = (uint32_t)tiles_size;
 
-    int end = jsnextsib(tokens, grid_tiles_id);
-    for (int i = grid_tiles_id + 1; i < end; i = jsnextsib(tokens, i)) {
-        if (tokens[i].type != JSMN_OBJECT) {
+    int end = jsnextsib(doc, grid_tiles_id);
+    for (int i = grid_tiles_id + 1; i < end; i = jsnextsib(doc, i)) {
+        if (doc->tokens[i].type != JSMN_OBJECT) {
             break;
         }
 
-        int coord_id = jstoi_or(js, jsget(js, tokens, i, "coordId"), -1);
-        int tile_id = jstoi_or(js, jsget(js, tokens, i, "tileId"), 0);
+        int coord_id = jstoi_or(doc->js, jsget(doc, i, "coordId"), -1);
+        int tile_id = jstoi_or(doc->js, jsget(doc, i, "tileId"), 0);
 
         if (coord_id >= 0 && tile_id > 0) {
             // printf("tile[%d]=%d\n", coord_id, tile_id);
@@ -212,13 +618,13 @@ tx_result parse_tile_layer(const char* js, jsmntok_t* tokens, int tok_id, game_l
     return TX_SUCCESS;
 }
 
-tx_result parse_int_grid_layer(const char* js, jsmntok_t* tokens, int tok_id, game_layer_inst* out)
+tx_result parse_int_grid_layer(const jsdoc* doc, int tok_id, game_layer_inst* out)
 {
     out->type = GAME_LAYER_TYPE_INTGRID;
-    out->cell_w = jstoi_or(js, jsget(js, tokens, tok_id, "__cWid"), 0);
-    out->cell_h = jstoi_or(js, jsget(js, tokens, tok_id, "__cHei"), 0);
-    out->cell_size = jstoi_or(js, jsget(js, tokens, tok_id, "__gridSize"), 0);
-    int int_grid_id = jsget_id(js, tokens, tok_id, "intGrid");
+    out->cell_w = jstoi_or(doc->js, jsget(doc, tok_id, "__cWid"), 0);
+    out->cell_h = jstoi_or(doc->js, jsget(doc, tok_id, "__cHei"), 0);
+    out->cell_size = jstoi_or(doc->js, jsget(doc, tok_id, "__gridSize"), 0);
+    int int_grid_id = jsget_id(doc, tok_id, "intGrid");
 
     if (out->cell_size == 0 || int_grid_id < 0) {
         return TX_INVALID;
@@ -227,15 +633,16 @@ tx_result parse_int_grid_layer(const char* js, jsmntok_t* tokens, int tok_id, ga
     size_t tiles_size = out->cell_w * out->cell_h;
     arrsetlen(out->tiles, tiles_size);
     memset(out->tiles, 0, sizeof(game_tile) * tiles_size);
+    out->tile_count = (uint32_t)tiles_size;
 
-    int end = jsnextsib(tokens, int_grid_id);
-    for (int i = int_grid_id + 1; i < end; i = jsnextsib(tokens, i)) {
-        if (tokens[i].type != JSMN_OBJECT) {
+    int end = jsnextsib(doc, int_grid_id);
+    for (int i = int_grid_id + 1; i < end; i = jsnextsib(doc, i)) {
+        if (doc->tokens[i].type != JSMN_OBJECT) {
             break;
         }
 
-        int coord_id = jstoi_or(js, jsget(js, tokens, i, "coordId"), -1);
-        int val = jstoi_or(js, jsget(js, tokens, i, "v"), 0);
+        int coord_id = jstoi_or(doc->js, jsget(doc, i, "coordId"), -1);
+        int val = jstoi_or(doc->js, jsget(doc, i, "v"), 0);
 
         if (coord_id >= 0 && val > 0) {
             // printf("int_grid[%d]=%d\n", coord_id, val);
@@ -248,13 +655,13 @@ tx_result parse_int_grid_layer(const char* js, jsmntok_t* tokens, int tok_id, ga
     return TX_SUCCESS;
 }
 
-tx_result parse_auto_layer(const char* js, jsmntok_t* tokens, int tok_id, game_layer_inst* out)
+tx_result parse_auto_layer(const jsdoc* doc, int tok_id, game_layer_inst* out)
 {
     out->type = GAME_LAYER_TYPE_TILES;
-    out->cell_w = jstoi_or(js, jsget(js, tokens, tok_id, "__cWid"), 0);
-    out->cell_h = jstoi_or(js, jsget(js, tokens, tok_id, "__cHei"), 0);
-    out->cell_size = jstoi_or(js, jsget(js, tokens, tok_id, "__gridSize"), 0);
-    int auto_layer_id = jsget_id(js, tokens, tok_id, "autoLayerTiles");
+    out->cell_w = jstoi_or(doc->js, jsget(doc, tok_id, "__cWid"), 0);
+    out->cell_h = jstoi_or(doc->js, jsget(doc, tok_id, "__cHei"), 0);
+    out->cell_size = jstoi_or(doc->js, jsget(doc, tok_id, "__gridSize"), 0);
+    int auto_layer_id = jsget_id(doc, tok_id, "autoLayerTiles");
 
     if (out->cell_size == 0 || auto_layer_id < 0) {
         return TX_INVALID;
@@ -263,23 +670,24 @@ tx_result parse_auto_layer(const char* js, jsmntok_t* tokens, int tok_id, game_l
     size_t tiles_size = out->cell_w * out->cell_h;
     arrsetlen(out->tiles, tiles_size);
     memset(out->tiles, 0, sizeof(game_tile) * tiles_size);
+    out->tile_count = (uint32_t)tiles_size;
 
-    int end = jsnextsib(tokens, auto_layer_id);
+    int end = jsnextsib(doc, auto_layer_id);
     int next = end;
     for (int i = auto_layer_id + 1; i < end; i = next) {
-        if (tokens[i].type != JSMN_OBJECT) {
+        if (doc->tokens[i].type != JSMN_OBJECT) {
             break;
         }
 
-        next = jsnextsib(tokens, i);
+        next = jsnextsib(doc, i);
 
-        int px_id = jsget_id(js, tokens, i, "px");
-        int src_id = jsget_id(js, tokens, i, "src");
-        int flips = jstoi_or(js, jsget(js, tokens, i, "f"), 0);
-        int data_id = jsget_id(js, tokens, i, "d");
+        int px_id = jsget_id(doc, i, "px");
+        int src_id = jsget_id(doc, i, "src");
+        int flips = jstoi_or(doc->js, jsget(doc, i, "f"), 0);
+        int data_id = jsget_id(doc, i, "d");
         int coord_id, tile_id;
-        jstoi(js, tokens[data_id + 2], &coord_id);
-        jstoi(js, tokens[data_id + 3], &tile_id);
+        jstoi(doc->js, doc->tokens[data_id + 2], &coord_id);
+        jstoi(doc->js, doc->tokens[data_id + 3], &tile_id);
 
         if (coord_id >= 0 && tile_id > 0 /* && out->tiles[coord_id].value == 0*/) {
             // printf("auto_layer[%d]=%d\n", coord_id, tile_id);
@@ -292,50 +700,46 @@ tx_result parse_auto_layer(const char* js, jsmntok_t* tokens, int tok_id, game_l
     return TX_SUCCESS;
 }
 
-tx_result parse_entity_layer(const char* js, jsmntok_t* tokens, int tok_id, game_layer_inst* out)
+tx_result parse_entity_layer(const jsdoc* doc, int tok_id, game_layer_inst* out)
 {
     out->type = GAME_LAYER_TYPE_ENTITIES;
-    int ent_insts_id = jsget_id(js, tokens, tok_id, "entityInstances");
+    int ent_insts_id = jsget_id(doc, tok_id, "entityInstances");
 
     if (ent_insts_id < 0) {
         return TX_INVALID;
     }
 
-    int ent_count = tokens[ent_insts_id].size;
+    int ent_count = doc->tokens[ent_insts_id].size;
     arrsetlen(out->ents, ent_count);
     memset(out->ents, 0, sizeof(game_ent_def_inst) * ent_count);
 
     int index = 0;
-    int end = jsnextsib(tokens, ent_insts_id);
-    for (int i = ent_insts_id + 1; i < end; i = jsnextsib(tokens, i)) {
-        if (tokens[i].type != JSMN_OBJECT) {
+    int end = jsnextsib(doc, ent_insts_id);
+    for (int i = ent_insts_id + 1; i < end; i = jsnextsib(doc, i)) {
+        if (doc->tokens[i].type != JSMN_OBJECT) {
             break;
         }
 
-        jsmntok_t id_tok = jsget(js, tokens, i, "__identifier");
+        jsmntok_t id_tok = jsget(doc, i, "__identifier");
         if (id_tok.type == JSMN_STRING) {
-            out->ents[index].id = strhash_get_len(js + id_tok.start, id_tok.end - id_tok.start);
+            out->ents[index].id =
+                strhash_get_len(doc->js + id_tok.start, id_tok.end - id_tok.start);
         } else {
             out->ents[index].id = (strhash){0};
         }
 
         int world_x_px, world_y_px;
 
-        int px_id = jsget_id(js, tokens, i, "px");
-        jstoi(js, tokens[px_id + 1], &world_x_px);
-        jstoi(js, tokens[px_id + 2], &world_y_px);
+        int px_id = jsget_id(doc, i, "px");
+        jstoi(doc->js, doc->tokens[px_id + 1], &world_x_px);
+        jstoi(doc->js, doc->tokens[px_id + 2], &world_y_px);
 
         out->ents[index].world_x = world_x_px / 8.0f;
         out->ents[index].world_y = world_y_px / 8.0f;
 
-        printf(
-            "Entity = { id = %s, x = %0.0f, y = %0.0f }\n",
-            strhash_cstr(out->ents[index].id),
-            out->ents[index].world_x,
-            out->ents[index].world_y);
-
         index++;
     }
+    out->ent_count = (uint32_t)index;
 
     return TX_SUCCESS;
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "futils.h"
 #include "strhash.h"
 #include "tx_types.h"
 
@@ -37,24 +38,47 @@ typedef enum game_layer_source_type {
     GAME_LAYER_SOURCE_TYPE_COUNT,
 } game_layer_source_type;
 
+// Tiles and ents are stbds arrays when parsed from json but point into the mapped file when loaded
+// from a level pack, use the counts rather than arrlen.
 typedef struct game_layer_inst {
     game_layer_type type;
     uint32_t cell_w;
     uint32_t cell_h;
     uint32_t cell_size;
+    uint32_t tile_count;
+    uint32_t ent_count;
     game_tile* tiles;
     game_ent_def_inst* ents;
 } game_layer_inst;
 
+enum { GAME_LEVEL_MAX_NEIGHBOURS = 8 };
+
 typedef struct game_level {
-    game_layer_inst* layer_insts;
+    game_layer_inst* layer_insts; // stbds_arr
+    uint32_t layer_count;
     strhash name_id;
+    int32_t uid;
+    // levels touching this one in the world, indices into the project's levels
+    uint32_t neighbours[GAME_LEVEL_MAX_NEIGHBOURS];
+    uint32_t neighbour_count;
 } game_level;
 
 typedef struct game_level_proj {
-    game_level* levels;
+    game_level* levels; // stbds_arr
+    uint32_t level_count;
+    file_map pack; // backs the tile and entity arrays when loaded from a level pack
 } game_level_proj;
 
 tx_result load_game_level_project(const char* filename, game_level_proj* proj);
 tx_result parse_game_level_project(const char* js, size_t len, game_level_proj* proj);
+
+// Parses layer instances as jobs spread over up to `threads` threads, the calling thread included.
+// Each layer's arrays are allocated by the thread that parses it.
+tx_result
+parse_game_level_project_jobs(const char* js, size_t len, game_level_proj* proj, int threads);
 tx_result free_game_level_project(game_level_proj* proj);
+
+// Level packs are cooked from a parsed project ahead of time (see game_level_pack.h) and mapped
+// into memory at load, tile and entity arrays are used in place without any parsing.
+tx_result save_game_level_pack(const char* filename, const game_level_proj* proj);
+tx_result load_game_level_pack(const char* filename, game_level_proj* proj);
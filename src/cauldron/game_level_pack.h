@@ -0,0 +1,61 @@
+// game_level_pack.h - Cooked Level Pack
+// binary form of a game level project written by `cauldron --cook-level` and mapped directly by
+// load_game_level_pack
+
+#pragma once
+
+#include "game_level.h"
+
+#include <stdint.h>
+
+#define GAME_LEVEL_PACK_MAGIC 0x4b504c47 // "GLPK"
+#define GAME_LEVEL_PACK_VERSION 2
+
+// File layout, all values little endian and every section 4 byte aligned:
+//   game_level_pack_header
+//   game_level_pack_level[level_count]
+//   game_level_pack_layer[layer_count]
+//   game_level_pack_string[string_count]
+//   game_tile and game_level_pack_ent arrays referenced by the layers
+//   null terminated string bytes referenced by the strings
+typedef struct game_level_pack_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t level_count;
+    uint32_t layer_count;
+    uint32_t string_count;
+} game_level_pack_header;
+
+typedef struct game_level_pack_level {
+    uint32_t name; // string index
+    uint32_t first_layer;
+    uint32_t layer_count;
+    int32_t uid;
+    uint32_t neighbour_count;
+    uint32_t neighbours[GAME_LEVEL_MAX_NEIGHBOURS]; // level indices
+} game_level_pack_level;
+
+// offsets are from the start of the file
+typedef struct game_level_pack_layer {
+    uint32_t type; // game_layer_type
+    uint32_t cell_w;
+    uint32_t cell_h;
+    uint32_t cell_size;
+    uint32_t tile_count;
+    uint32_t tiles_offset;
+    uint32_t ent_count;
+    uint32_t ents_offset;
+} game_level_pack_layer;
+
+typedef struct game_level_pack_string {
+    uint32_t offset;
+    uint32_t len; // excluding the null terminator
+} game_level_pack_string;
+
+// Same layout as game_ent_def_inst, the string index is replaced with the interned strhash when the
+// pack is loaded so entities are used in place.
+typedef struct game_level_pack_ent {
+    uint32_t id; // string index
+    float world_x;
+    float world_y;
+} game_level_pack_ent;
@@ -26,46 +26,50 @@ bool load_game_settings(const char* file_override)
         return result;
     }
 
-    jsmn_parser parser;
-    jsmn_init(&parser);
+    jsdoc doc;
+    jsdoc_parse(&doc, js, len);
 
-    int tok_needed = jsmn_parse(&parser, js, len, NULL, 0);
-    jsmntok_t* tokens = NULL;
-    arrsetlen(tokens, tok_needed);
-
-    jsmn_init(&parser);
-    int tok_len = jsmn_parse(&parser, js, len, tokens, tok_needed);
-
-    int opt_id = jsget_id(js, tokens, 0, "options");
+    int opt_id = jsget_id(&doc, 0, "options");
     {
-        int video_opt_id = jsget_id(js, tokens, opt_id, "video");
+        int video_opt_id = jsget_id(&doc, opt_id, "video");
         {
             settings.options.video.display_width =
-                jstoi_or(js, jsget(js, tokens, video_opt_id, "display_width"), 0);
+                jstoi_or(js, jsget(&doc, video_opt_id, "display_width"), 0);
 
             settings.options.video.display_height =
-                jstoi_or(js, jsget(js, tokens, video_opt_id, "display_height"), 0);
+                jstoi_or(js, jsget(&doc, video_opt_id, "display_height"), 0);
 
             settings.options.video.enable_vsync =
-                jstob_or(js, jsget(js, tokens, video_opt_id, "enable_vsync"), false);
+                jstob_or(js, jsget(&doc, video_opt_id, "enable_vsync"), false);
 
             settings.options.video.frame_limit =
-                jstoi_or(js, jsget(js, tokens, video_opt_id, "frame_limit"), 0);
+                jstoi_or(js, jsget(&doc, video_opt_id, "frame_limit"), 0);
+
+            jstof(
+                js,
+                jsget(&doc, video_opt_id, "dynamic_resolution_budget_ms"),
+                &settings.options.video.dynamic_resolution_budget_ms);
+        }
+
+        int memory_opt_id = jsget_id(&doc, opt_id, "memory");
+        {
+            settings.options.memory.level_cache_budget_kb =
+                jstoi_or(js, jsget(&doc, memory_opt_id, "level_cache_budget_kb"), 0);
         }
     }
 
-    int startup_id = jsget_id(js, tokens, 0, "startup");
+    int startup_id = jsget_id(&doc, 0, "startup");
     {
         enum { BUF_LEN = 64 };
         char buffer[BUF_LEN] = {0};
-        jsmntok_t level_tok = jsget(js, tokens, startup_id, "level");
+        jsmntok_t level_tok = jsget(&doc, startup_id, "level");
         int len = level_tok.end - level_tok.start;
         if (len > 0) {
             settings.startup.level_id = strhash_get_len(js + level_tok.start, len);
         }
     }
 
-    arrfree(tokens);
+    jsdoc_free(&doc);
 
     return TX_SUCCESS;
 }
\ No newline at end of file
@@ -10,7 +10,11 @@ typedef struct game_settings {
             int display_height;
             bool enable_vsync;
             int frame_limit;
+            float dynamic_resolution_budget_ms; // 0 keeps the canvas at full resolution
         } video;
+        struct {
+            int level_cache_budget_kb; // 0 uses the level cache default
+        } memory;
     } options;
     struct {
         strhash level_id;
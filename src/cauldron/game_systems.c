@@ -116,6 +116,7 @@ tx_result game_systems_init(game_settings* settings)
             .term = level_system_term,
             .load_level = level_system_load_level,
             .unload_level = level_system_unload_level,
+            .update = level_system_update,
             .render = level_system_render,
         }));
 
@@ -0,0 +1,104 @@
+#include "gpu_timer.h"
+
+#include <GL/gl3w.h>
+#include <string.h>
+
+enum {
+    // frames of queries kept in flight before their results are read
+    K_GPU_TIMER_FRAMES = 4,
+};
+
+struct timer_frame {
+    GLuint begin_queries[GPU_TIMER_MAX];
+    GLuint end_queries[GPU_TIMER_MAX];
+    bool issued[GPU_TIMER_MAX];
+};
+
+struct {
+    struct timer_frame frames[K_GPU_TIMER_FRAMES];
+    float ms[GPU_TIMER_MAX];
+    uint32_t frame;
+    bool initialized;
+} gpu_timers;
+
+void gpu_timer_init(void)
+{
+    for (int i = 0; i < K_GPU_TIMER_FRAMES; ++i) {
+        glGenQueries(GPU_TIMER_MAX, gpu_timers.frames[i].begin_queries);
+        glGenQueries(GPU_TIMER_MAX, gpu_timers.frames[i].end_queries);
+    }
+    gpu_timers.initialized = true;
+}
+
+void gpu_timer_term(void)
+{
+    if (!gpu_timers.initialized) {
+        return;
+    }
+
+    for (int i = 0; i < K_GPU_TIMER_FRAMES; ++i) {
+        glDeleteQueries(GPU_TIMER_MAX, gpu_timers.frames[i].begin_queries);
+        glDeleteQueries(GPU_TIMER_MAX, gpu_timers.frames[i].end_queries);
+    }
+    memset(&gpu_timers, 0, sizeof(gpu_timers));
+}
+
+void gpu_timer_begin(uint32_t timer)
+{
+    TX_ASSERT(VALID_INDEX(timer, GPU_TIMER_MAX));
+
+    if (!gpu_timers.initialized) {
+        return;
+    }
+
+    struct timer_frame* frame = &gpu_timers.frames[gpu_timers.frame % K_GPU_TIMER_FRAMES];
+    glQueryCounter(frame->begin_queries[timer], GL_TIMESTAMP);
+}
+
+void gpu_timer_end(uint32_t timer)
+{
+    TX_ASSERT(VALID_INDEX(timer, GPU_TIMER_MAX));
+
+    if (!gpu_timers.initialized) {
+        return;
+    }
+
+    struct timer_frame* frame = &gpu_timers.frames[gpu_timers.frame % K_GPU_TIMER_FRAMES];
+    glQueryCounter(frame->end_queries[timer], GL_TIMESTAMP);
+    frame->issued[timer] = true;
+}
+
+void gpu_timer_next_frame(void)
+{
+    if (!gpu_timers.initialized) {
+        return;
+    }
+
+    gpu_timers.frame++;
+
+    // the oldest frame is about to be reused, collect whatever it recorded
+    struct timer_frame* frame = &gpu_timers.frames[gpu_timers.frame % K_GPU_TIMER_FRAMES];
+    for (uint32_t i = 0; i < GPU_TIMER_MAX; ++i) {
+        if (!frame->issued[i]) {
+            continue;
+        }
+        frame->issued[i] = false;
+
+        GLint available = 0;
+        glGetQueryObjectiv(frame->end_queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(frame->begin_queries[i], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame->end_queries[i], GL_QUERY_RESULT, &end);
+        gpu_timers.ms[i] = (float)((double)(end - begin) / 1000000.0);
+    }
+}
+
+float gpu_timer_get_ms(uint32_t timer)
+{
+    TX_ASSERT(VALID_INDEX(timer, GPU_TIMER_MAX));
+    return gpu_timers.ms[timer];
+}
@@ -0,0 +1,22 @@
+// gpu_timer.h - GPU Timers
+// GL timestamp queries around blocks of GPU work. Results are read back a few frames late so the
+// CPU never waits on the GPU.
+
+#pragma once
+
+#include "tx_types.h"
+
+enum { GPU_TIMER_MAX = 8 };
+
+// requires a current GL context
+void gpu_timer_init(void);
+void gpu_timer_term(void);
+
+void gpu_timer_begin(uint32_t timer);
+void gpu_timer_end(uint32_t timer);
+
+// Call once per frame after all timers have been recorded.
+void gpu_timer_next_frame(void);
+
+// latest resolved duration of the timer in milliseconds, 0 until a result is available
+float gpu_timer_get_ms(uint32_t timer);
@@ -1,5 +1,7 @@
 #include "jsonutil.h"
 
+#include "hash.h"
+
 bool jseq(const char* js, jsmntok_t token, const char* str)
 {
     return token.type == JSMN_STRING && (int)strlen(str) == token.end - token.start
@@ -88,6 +90,78 @@ bool jstob_or(const char* js, jsmntok_t token, bool def)
     return def;
 }
 
+int jsparse(const char* js, size_t len, jsmntok_t** tokens)
+{
+    jsmn_parser parser;
+    jsmn_init(&parser);
+
+    // a guess of one token per 8 bytes, jsmn keeps its position on JSMN_ERROR_NOMEM so growing the
+    // array and calling it again continues the scan instead of restarting it
+    arrsetlen(*tokens, len / 8 + 16);
+    for (;;) {
+        int ret = jsmn_parse(&parser, js, len, *tokens, (unsigned int)arrlen(*tokens));
+        if (ret != JSMN_ERROR_NOMEM) {
+            arrsetlen(*tokens, (ret > 0) ? ret : 0);
+            return ret;
+        }
+        arrsetlen(*tokens, arrlen(*tokens) * 2);
+    }
+}
+
+static uint64_t jskey(int object_id, const char* str, int len)
+{
+    return ((uint64_t)object_id << 32) | hash_data(str, len);
+}
+
+int jsdoc_parse(jsdoc* doc, const char* js, size_t len)
+{
+    *doc = (jsdoc){.js = js};
+
+    int tok_len = jsparse(js, len, &doc->tokens);
+    if (tok_len <= 0) {
+        return tok_len;
+    }
+
+    // Tokens are in document order and every token's parent comes before it, so walking backwards
+    // finishes each subtree before its parent. The token after a subtree is its next sibling.
+    // REQUIRES JSMN_PARENT_LINKS to be defined so that jsmntok_t contains the parent index.
+    arrsetlen(doc->next, tok_len);
+    for (int i = 0; i < tok_len; ++i) {
+        doc->next[i] = i + 1;
+    }
+    for (int i = tok_len - 1; i >= 0; --i) {
+        int parent = doc->tokens[i].parent;
+        if (parent >= 0 && doc->next[i] > doc->next[parent]) {
+            doc->next[parent] = doc->next[i];
+        }
+    }
+
+    for (int i = 0; i < tok_len; ++i) {
+        if (doc->tokens[i].type != JSMN_OBJECT || doc->tokens[i].size < JS_KEY_INDEX_MIN_KEYS) {
+            continue;
+        }
+
+        // walked in order so the first of any duplicate keys wins, the same as a linear search
+        for (int k = i + 1; k < doc->next[i]; k = doc->next[k]) {
+            jsmntok_t key_tok = doc->tokens[k];
+            uint64_t key = jskey(i, js + key_tok.start, key_tok.end - key_tok.start);
+            if (hmgeti(doc->keys, key) < 0) {
+                hmput(doc->keys, key, k + 1);
+            }
+        }
+    }
+
+    return tok_len;
+}
+
+void jsdoc_free(jsdoc* doc)
+{
+    arrfree(doc->tokens);
+    arrfree(doc->next);
+    hmfree(doc->keys);
+    doc->js = NULL;
+}
+
 // for a given token id find the next sibling token (token with the same parent id).
 // The behavior is a little different depending on what tok_id refers to:
 //  * key of an object -> the next key in the same object.
@@ -96,39 +170,47 @@ bool jstob_or(const char* js, jsmntok_t token, bool def)
 // In any case if no sibling is found at the current depth continue checking at higher depths.
 // If no more tokens are found then tok_len (arrlen(tokens)) will be returned.
 // tok_id outside of the range [0, tok_len) will yield tok_len
-// REQUIRES JSMN_PARENT_LINKS to be defined so that jsmntok_t contains the parent index.
-int jsnextsib(jsmntok_t* tokens, int tok_id)
+int jsnextsib(const jsdoc* doc, int tok_id)
 {
-    size_t tok_len = arrlen(tokens);
+    int tok_len = (int)arrlen(doc->tokens);
     if (tok_id >= 0 && tok_id < tok_len) {
-        const int base_parent = tokens[tok_id].parent;
-        for (int cur_id = tok_id + 1; cur_id < tok_len; ++cur_id) {
-            if (tokens[cur_id].parent <= base_parent) {
-                return cur_id;
-            }
-        }
+        return doc->next[tok_id];
     }
-    return (int)tok_len;
+    return tok_len;
 }
 
-jsmntok_t jsget(const char* js, jsmntok_t* tokens, int parent_id, const char* key)
+jsmntok_t jsget(const jsdoc* doc, int parent_id, const char* key)
 {
-    int id = jsget_id(js, tokens, parent_id, key);
+    int id = jsget_id(doc, parent_id, key);
     if (id >= 0) {
-        return tokens[id];
+        return doc->tokens[id];
     }
     return (jsmntok_t){0};
 }
 
-int jsget_id(const char* js, jsmntok_t* tokens, int parent_id, const char* key)
+int jsget_id(const jsdoc* doc, int parent_id, const char* key)
 {
-    if (parent_id < 0 || parent_id >= arrlen(tokens) || tokens[parent_id].type != JSMN_OBJECT) {
+    if (parent_id < 0 || parent_id >= arrlen(doc->tokens)
+        || doc->tokens[parent_id].type != JSMN_OBJECT) {
         return -1;
     }
 
-    int next = jsnextsib(tokens, parent_id);
-    for (int i = parent_id + 1; i < next; i = jsnextsib(tokens, i)) {
-        if (jseq(js, tokens[i], key)) {
+    if (doc->tokens[parent_id].size >= JS_KEY_INDEX_MIN_KEYS) {
+        ptrdiff_t found = hmgeti(doc->keys, jskey(parent_id, key, (int)strlen(key)));
+        if (found < 0) {
+            return -1;
+        }
+
+        // a different key with the same hash falls through to the search below
+        int id = doc->keys[found].value;
+        if (jseq(doc->js, doc->tokens[id - 1], key)) {
+            return id;
+        }
+    }
+
+    int next = jsnextsib(doc, parent_id);
+    for (int i = parent_id + 1; i < next; i = jsnextsib(doc, i)) {
+        if (jseq(doc->js, doc->tokens[i], key)) {
             return i + 1;
         }
     }
@@ -17,6 +17,32 @@ bool jstoi(const char* js, jsmntok_t token, int* out);
 bool jstob(const char* js, jsmntok_t token, bool* out);
 int jstoi_or(const char* js, jsmntok_t token, int def);
 bool jstob_or(const char* js, jsmntok_t token, bool def);
-int jsnextsib(jsmntok_t* tokens, int tok_id);
-jsmntok_t jsget(const char* js, jsmntok_t* tokens, int parent_id, const char* key);
-int jsget_id(const char* js, jsmntok_t* tokens, int parent_id, const char* key);
+// Tokenizes js in a single pass into the stbds array *tokens, growing it and resuming jsmn whenever
+// it runs out of tokens. Returns the token count, which is also the array length, or a jsmn error
+// in which case the array is left empty. Release with arrfree.
+int jsparse(const char* js, size_t len, jsmntok_t** tokens);
+
+// objects with at least this many keys get their keys hashed for constant time lookups
+enum { JS_KEY_INDEX_MIN_KEYS = 8 };
+
+typedef struct jskey_index {
+    uint64_t key; // object token id << 32 | hash of the key string
+    int value;    // token id of the key's value
+} jskey_index;
+
+// Tokens of a parsed document along with the tables that make traversal constant time.
+typedef struct jsdoc {
+    const char* js;
+    jsmntok_t* tokens; // stbds_arr
+    int* next;         // stbds_arr, next sibling of each token, see jsnextsib
+    jskey_index* keys; // stbds_hm
+} jsdoc;
+
+// Tokenizes js with jsparse and builds the sibling and key tables, js must outlive the document.
+// Returns the token count or a jsmn error, the document is empty but still valid on error.
+int jsdoc_parse(jsdoc* doc, const char* js, size_t len);
+void jsdoc_free(jsdoc* doc);
+
+int jsnextsib(const jsdoc* doc, int tok_id);
+jsmntok_t jsget(const jsdoc* doc, int parent_id, const char* key);
+int jsget_id(const jsdoc* doc, int parent_id, const char* key);
@@ -0,0 +1,241 @@
+#include "level_cache.h"
+
+#include "game_level.h"
+#include "stb_ds.h"
+
+#define K_LEVEL_CACHE_DEFAULT_BUDGET (16 * 1024 * 1024)
+
+typedef struct level_cache_entry {
+    const game_level* level;
+    void* data[LEVEL_CACHE_SLOT_COUNT];
+    size_t bytes[LEVEL_CACHE_SLOT_COUNT];
+    uint64_t last_used;
+} level_cache_entry;
+
+typedef struct level_cache_slot_procs {
+    level_cache_build_proc build;
+    level_cache_free_proc free_proc;
+} level_cache_slot_procs;
+
+struct {
+    level_cache_slot_procs procs[LEVEL_CACHE_SLOT_COUNT];
+    level_cache_entry* entries;    // stbds_arr
+    const game_level** prefetches; // stbds_arr, oldest first
+    const game_level* active;
+    size_t budget; // bytes, K_LEVEL_CACHE_DEFAULT_BUDGET while 0
+    size_t bytes;
+    uint64_t clock; // ticks on every use to order entries by recency
+} level_cache;
+
+static level_cache_entry* find_entry(const game_level* level)
+{
+    for (int i = 0; i < arrlen(level_cache.entries); ++i) {
+        if (level_cache.entries[i].level == level) {
+            return &level_cache.entries[i];
+        }
+    }
+    return NULL;
+}
+
+static level_cache_entry* get_entry(const game_level* level)
+{
+    level_cache_entry* entry = find_entry(level);
+    if (!entry) {
+        arrput(level_cache.entries, ((level_cache_entry){.level = level}));
+        entry = &arrlast(level_cache.entries);
+    }
+    return entry;
+}
+
+static void free_entry(level_cache_entry* entry)
+{
+    for (int slot = 0; slot < LEVEL_CACHE_SLOT_COUNT; ++slot) {
+        if (entry->data[slot] && level_cache.procs[slot].free_proc) {
+            level_cache.procs[slot].free_proc(entry->data[slot]);
+        }
+        level_cache.bytes -= entry->bytes[slot];
+        entry->data[slot] = NULL;
+        entry->bytes[slot] = 0;
+    }
+}
+
+static void build_slot(level_cache_entry* entry, level_cache_slot slot)
+{
+    const level_cache_slot_procs* procs = &level_cache.procs[slot];
+    TX_ASSERT(procs->build);
+
+    size_t bytes = 0;
+    entry->data[slot] = procs->build(entry->level, &bytes);
+    entry->bytes[slot] = bytes;
+    level_cache.bytes += bytes;
+}
+
+static void evict_over_budget(void)
+{
+    size_t budget = level_cache.budget ? level_cache.budget : K_LEVEL_CACHE_DEFAULT_BUDGET;
+
+    while (level_cache.bytes > budget) {
+        int lru = -1;
+        for (int i = 0; i < arrlen(level_cache.entries); ++i) {
+            const level_cache_entry* entry = &level_cache.entries[i];
+            if (entry->level != level_cache.active
+                && (lru < 0 || entry->last_used < level_cache.entries[lru].last_used)) {
+                lru = i;
+            }
+        }
+
+        // only the active level is left, it stays regardless of the budget
+        if (lru < 0) {
+            break;
+        }
+
+        free_entry(&level_cache.entries[lru]);
+        arrdelswap(level_cache.entries, lru);
+    }
+}
+
+void level_cache_register(
+    level_cache_slot slot,
+    level_cache_build_proc build,
+    level_cache_free_proc free_proc)
+{
+    TX_ASSERT(VALID_INDEX(slot, LEVEL_CACHE_SLOT_COUNT));
+
+    level_cache.procs[slot] = (level_cache_slot_procs){
+        .build = build,
+        .free_proc = free_proc,
+    };
+}
+
+void level_cache_set_budget(size_t budget_bytes)
+{
+    level_cache.budget = budget_bytes;
+    evict_over_budget();
+}
+
+void level_cache_term(void)
+{
+    level_cache_clear();
+    arrfree(level_cache.entries);
+    arrfree(level_cache.prefetches);
+}
+
+void* level_cache_acquire(const game_level* level, level_cache_slot slot)
+{
+    TX_ASSERT(level && VALID_INDEX(slot, LEVEL_CACHE_SLOT_COUNT));
+
+    level_cache_entry* entry = get_entry(level);
+    entry->last_used = ++level_cache.clock;
+    if (!entry->data[slot]) {
+        build_slot(entry, slot);
+    }
+    return entry->data[slot];
+}
+
+void* level_cache_build(const game_level* level, level_cache_slot slot, size_t* bytes)
+{
+    TX_ASSERT(level && VALID_INDEX(slot, LEVEL_CACHE_SLOT_COUNT));
+    TX_ASSERT(level_cache.procs[slot].build);
+
+    *bytes = 0;
+    return level_cache.procs[slot].build(level, bytes);
+}
+
+void level_cache_discard(level_cache_slot slot, void* data)
+{
+    TX_ASSERT(VALID_INDEX(slot, LEVEL_CACHE_SLOT_COUNT));
+
+    if (data && level_cache.procs[slot].free_proc) {
+        level_cache.procs[slot].free_proc(data);
+    }
+}
+
+void level_cache_put(const game_level* level, level_cache_slot slot, void* data, size_t bytes)
+{
+    TX_ASSERT(level && VALID_INDEX(slot, LEVEL_CACHE_SLOT_COUNT));
+
+    level_cache_entry* entry = get_entry(level);
+    entry->last_used = ++level_cache.clock;
+
+    if (entry->data[slot] && level_cache.procs[slot].free_proc) {
+        level_cache.procs[slot].free_proc(entry->data[slot]);
+    }
+    level_cache.bytes -= entry->bytes[slot];
+
+    entry->data[slot] = data;
+    entry->bytes[slot] = bytes;
+    level_cache.bytes += bytes;
+}
+
+bool level_cache_contains(const game_level* level, level_cache_slot slot)
+{
+    const level_cache_entry* entry = find_entry(level);
+    return entry && entry->data[slot];
+}
+
+void level_cache_set_active(const game_level* level)
+{
+    level_cache.active = level;
+    arrsetlen(level_cache.prefetches, 0);
+}
+
+void level_cache_prefetch(const game_level* level)
+{
+    if (!level || level == level_cache.active) {
+        return;
+    }
+
+    for (int i = 0; i < arrlen(level_cache.prefetches); ++i) {
+        if (level_cache.prefetches[i] == level) {
+            return;
+        }
+    }
+    arrput(level_cache.prefetches, level);
+}
+
+void level_cache_update(void)
+{
+    // prefetching into a full cache would only evict what it just built
+    size_t budget = level_cache.budget ? level_cache.budget : K_LEVEL_CACHE_DEFAULT_BUDGET;
+    if (level_cache.bytes >= budget) {
+        arrsetlen(level_cache.prefetches, 0);
+    }
+
+    while (arrlen(level_cache.prefetches) > 0) {
+        level_cache_entry* entry = get_entry(level_cache.prefetches[0]);
+
+        int slot = 0;
+        while (slot < LEVEL_CACHE_SLOT_COUNT
+               && (entry->data[slot] || !level_cache.procs[slot].build)) {
+            ++slot;
+        }
+
+        if (slot == LEVEL_CACHE_SLOT_COUNT) {
+            arrdel(level_cache.prefetches, 0);
+            continue;
+        }
+
+        // prefetched levels count as used now so they outlive older levels in the cache
+        entry->last_used = ++level_cache.clock;
+        build_slot(entry, (level_cache_slot)slot);
+        break;
+    }
+
+    evict_over_budget();
+}
+
+void level_cache_clear(void)
+{
+    for (int i = 0; i < arrlen(level_cache.entries); ++i) {
+        free_entry(&level_cache.entries[i]);
+    }
+    arrsetlen(level_cache.entries, 0);
+    arrsetlen(level_cache.prefetches, 0);
+    level_cache.active = NULL;
+    level_cache.bytes = 0;
+}
+
+size_t level_cache_bytes(void)
+{
+    return level_cache.bytes;
+}
@@ -0,0 +1,60 @@
+// level_cache.h - Level Cache
+// Keeps the runtime state systems derive from a level (render chunks, physics grid, spawn lists)
+// around after the level is unloaded so returning to it, or moving to a prefetched neighbour, skips
+// rebuilding it. Least recently used levels are evicted once the cache is over its memory budget.
+
+#pragma once
+
+#include "game_systems_forward.h"
+#include "tx_types.h"
+
+typedef enum level_cache_slot {
+    LEVEL_CACHE_SLOT_RENDER_CHUNKS,
+    LEVEL_CACHE_SLOT_PHYS_GRID,
+    LEVEL_CACHE_SLOT_SPAWNS,
+    LEVEL_CACHE_SLOT_COUNT,
+} level_cache_slot;
+
+// Builds a slot's data for a level and reports how many bytes it holds on to, CPU and GPU.
+typedef void* (*level_cache_build_proc)(const game_level* level, size_t* bytes);
+typedef void (*level_cache_free_proc)(void* data);
+
+// Each system registers how to build and free its slot, usually from its init.
+void level_cache_register(
+    level_cache_slot slot,
+    level_cache_build_proc build,
+    level_cache_free_proc free_proc);
+
+void level_cache_set_budget(size_t budget_bytes);
+void level_cache_term(void);
+
+// Slot data of a level, built now when it isn't cached. The cache owns the data and keeps it until
+// the level is evicted, which never happens to the active level.
+void* level_cache_acquire(const game_level* level, level_cache_slot slot);
+
+// Builds a slot's data with its registered build proc without caching it, so slots whose build
+// touches no GPU state can be prepared on another thread. The procs are only read here, but the
+// caller must not run level_cache_update at the same time since it builds with the same procs. Hand
+// the result to level_cache_put, or to level_cache_discard when it isn't needed after all.
+void* level_cache_build(const game_level* level, level_cache_slot slot, size_t* bytes);
+void level_cache_discard(level_cache_slot slot, void* data);
+
+// Hands the cache slot data that was built elsewhere, e.g. from chunks prepared by streaming.
+void level_cache_put(const game_level* level, level_cache_slot slot, void* data, size_t bytes);
+
+bool level_cache_contains(const game_level* level, level_cache_slot slot);
+
+// The active level is pinned, any previously queued prefetches are dropped.
+void level_cache_set_active(const game_level* level);
+
+// Queues every slot of a level to be built by level_cache_update.
+void level_cache_prefetch(const game_level* level);
+
+// Builds at most one queued slot so prefetching is spread over frames, then evicts least recently
+// used levels until the cache fits its budget.
+void level_cache_update(void);
+
+// Frees every cached level, required before the levels themselves are freed.
+void level_cache_clear(void);
+
+size_t level_cache_bytes(void);
@@ -2,46 +2,400 @@
 #include "entity_system.h"
 #include "event_system.h"
 #include "game_level.h"
+#include "game_settings.h"
 #include "game_systems.h"
+#include "level_cache.h"
 #include "sprite_draw.h"
 
+#include <SDL2/SDL.h>
+
+enum { LEVEL_CHUNK_SIZE = 32 };
+
+#define K_LEVEL_PROJECT_PATH "assets/test_level.json"
+#define K_LEVEL_PACK_PATH "assets/test_level.lvlpack"
+
+// a square region of a tile layer baked into an immutable sprite batch at load time
+typedef struct level_chunk {
+    sprite_batch_handle batch;
+    vec2 min;
+    vec2 max;
+} level_chunk;
+
+// every chunk of a level, owned by the level cache
+typedef struct level_chunk_set {
+    level_chunk* chunks; // stbds_arr
+} level_chunk_set;
+
+// tile descriptions of a chunk, built off the main thread and turned into a batch on it
+typedef struct level_chunk_build {
+    sprite_draw_desc* descs; // stbds_arr
+    vec2 min;
+    vec2 max;
+} level_chunk_build;
+
+typedef enum level_stream_type {
+    LEVEL_STREAM_NONE,
+    LEVEL_STREAM_LEVEL,   // prepare a level of the current project
+    LEVEL_STREAM_PROJECT, // load the project again, then prepare the level in the new project
+} level_stream_type;
+
+// Level changes and project reloads run on a worker thread and are swapped in between frames by
+// level_system_update once done. One job runs at a time, requests made while it runs replace any
+// earlier pending request. The worker prepares everything a level needs even when it is cached,
+// the cache may evict it before the job is swapped in.
+typedef struct level_stream_job {
+    level_stream_type type;
+    strhash level_id;
+    game_level_proj proj; // LEVEL_STREAM_PROJECT only
+    tx_result result;
+    game_level* level;         // prepared level, in proj for project jobs
+    level_chunk_build* builds; // stbds_arr
+    // level cache slots handed to the cache on swap, render chunks need the GPU so they are
+    // prepared as builds instead
+    void* slots[LEVEL_CACHE_SLOT_COUNT];
+    size_t slot_bytes[LEVEL_CACHE_SLOT_COUNT];
+} level_stream_job;
+
 game_level_proj proj = {0};
 game_level* active = NULL;
+const level_chunk_set* active_chunks = NULL;
 
-void on_change_level(event_message* message)
+typedef struct level_index {
+    uint32_t key; // strhash value of the level name
+    uint32_t value;
+} level_index;
+
+level_index* level_indices = NULL; // stbds_hm, levels of proj by name
+
+struct {
+    SDL_Thread* thread;
+    SDL_atomic_t done;
+    level_stream_job job;     // owned by the worker until done is set
+    level_stream_job pending; // type is LEVEL_STREAM_NONE when nothing is pending
+    level_chunk_build* ready; // stbds_arr, see level_system_load_level
+    game_level* ready_level;  // level the ready chunks were built for
+} stream;
+
+// Prefers the cooked level pack, the json is parsed instead when no pack has been cooked or the
+// project has been saved since so edits show up on reload without recooking.
+static tx_result load_level_project(game_level_proj* out)
 {
-    change_level_event* change_level = (change_level_event*)message;
+    int64_t project_mtime = 0, pack_mtime = 0;
+    if (get_file_mtime(K_LEVEL_PACK_PATH, &pack_mtime) == TX_SUCCESS
+        && (get_file_mtime(K_LEVEL_PROJECT_PATH, &project_mtime) != TX_SUCCESS
+            || pack_mtime >= project_mtime)) {
+        if (load_game_level_pack(K_LEVEL_PACK_PATH, out) == TX_SUCCESS) {
+            return TX_SUCCESS;
+        }
+        printf("level pack '%s' is invalid, parsing the project instead.\n", K_LEVEL_PACK_PATH);
+    }
 
-    if (active) {
-        game_systems_unload_level();
+    return load_game_level_project(K_LEVEL_PROJECT_PATH, out);
+}
+
+static void index_levels(void)
+{
+    hmfree(level_indices);
+    for (uint32_t i = 0; i < proj.level_count; ++i) {
+        hmput(level_indices, proj.levels[i].name_id.value, i);
     }
-    active = level_find_id(change_level->level_id);
-    if (active) {
-        game_systems_load_level(active);
+}
+
+static game_level* find_level(game_level_proj* in_proj, strhash id)
+{
+    for (uint32_t i = 0; i < in_proj->level_count; ++i) {
+        if (in_proj->levels[i].name_id.value == id.value) {
+            return &in_proj->levels[i];
+        }
     }
+    return NULL;
 }
 
-void on_reload_level_proj(event_message* message)
+static sprite_draw_desc tile_sprite_desc(game_tile tile, uint32_t x, uint32_t y)
+{
+    sprite_flip flip = SPRITE_FLIP_NONE;
+    if ((tile.flags & GAME_TILE_FLAGS_FLIP_X) != 0) {
+        flip |= SPRITE_FLIP_X;
+    }
+    if ((tile.flags & GAME_TILE_FLAGS_FILP_Y) != 0) {
+        flip |= SPRITE_FLIP_Y;
+    }
+
+    return (sprite_draw_desc){
+        .sprite_id = tile.value,
+        .pos = (vec2){.x = (float)x, .y = (float)y},
+        .flip = flip,
+    };
+}
+
+// Splits a tile layer into LEVEL_CHUNK_SIZE square chunks, touches no renderer state so it is safe
+// to run on any thread.
+static void build_layer_chunks(const game_layer_inst* layer, level_chunk_build** builds)
+{
+    for (uint32_t cy = 0; cy < layer->cell_h; cy += LEVEL_CHUNK_SIZE) {
+        for (uint32_t cx = 0; cx < layer->cell_w; cx += LEVEL_CHUNK_SIZE) {
+            uint32_t ex = cx + LEVEL_CHUNK_SIZE;
+            uint32_t ey = cy + LEVEL_CHUNK_SIZE;
+            ex = (ex < layer->cell_w) ? ex : layer->cell_w;
+            ey = (ey < layer->cell_h) ? ey : layer->cell_h;
+
+            sprite_draw_desc* descs = NULL; // stbds_arr
+            for (uint32_t y = cy; y < ey; ++y) {
+                for (uint32_t x = cx; x < ex; ++x) {
+                    game_tile tile = layer->tiles[x + y * layer->cell_w];
+                    if (tile.value > 0) {
+                        arrput(descs, tile_sprite_desc(tile, x, y));
+                    }
+                }
+            }
+
+            if (arrlen(descs) == 0) {
+                continue;
+            }
+
+            arrput(
+                *builds,
+                ((level_chunk_build){
+                    .descs = descs,
+                    .min = {.x = (float)cx, .y = (float)cy},
+                    .max = {.x = (float)ex, .y = (float)ey},
+                }));
+        }
+    }
+}
+
+static void build_level_chunks(const game_level* level, level_chunk_build** builds)
+{
+    for (uint32_t lid = 0; lid < level->layer_count; ++lid) {
+        const game_layer_inst* layer = &level->layer_insts[lid];
+        if (layer->type == GAME_LAYER_TYPE_TILES) {
+            build_layer_chunks(layer, builds);
+        }
+    }
+}
+
+static void free_chunk_builds(level_chunk_build** builds)
+{
+    for (int i = 0; i < arrlen(*builds); ++i) {
+        arrfree((*builds)[i].descs);
+    }
+    arrfree(*builds);
+}
+
+static level_chunk_set* create_chunk_set(const level_chunk_build* builds, size_t* bytes)
+{
+    level_chunk_set* set = calloc(1, sizeof(level_chunk_set));
+    *bytes = sizeof(level_chunk_set);
+
+    for (int i = 0; i < arrlen(builds); ++i) {
+        sprite_batch_handle batch =
+            spr_batch_create(builds[i].descs, (uint32_t)arrlen(builds[i].descs));
+        arrput(
+            set->chunks,
+            ((level_chunk){
+                .batch = batch,
+                .min = builds[i].min,
+                .max = builds[i].max,
+            }));
+        *bytes += sizeof(level_chunk) + spr_batch_get_bytes(batch);
+    }
+
+    return set;
+}
+
+static void* build_render_chunks(const game_level* level, size_t* bytes)
+{
+    level_chunk_build* builds = NULL; // stbds_arr
+    build_level_chunks(level, &builds);
+    level_chunk_set* set = create_chunk_set(builds, bytes);
+    free_chunk_builds(&builds);
+    return set;
+}
+
+static void free_render_chunks(void* data)
+{
+    level_chunk_set* set = (level_chunk_set*)data;
+    for (int i = 0; i < arrlen(set->chunks); ++i) {
+        spr_batch_destroy(set->chunks[i].batch);
+    }
+    arrfree(set->chunks);
+    free(set);
+}
+
+// Queues the levels the player can walk to from this one, projects without neighbour data fall back
+// to the levels either side of it in the project.
+static void prefetch_neighbours(const game_level* level)
+{
+    if (level->neighbour_count > 0) {
+        for (uint32_t i = 0; i < level->neighbour_count; ++i) {
+            level_cache_prefetch(&proj.levels[level->neighbours[i]]);
+        }
+        return;
+    }
+
+    ptrdiff_t index = level - proj.levels;
+    if (index > 0) {
+        level_cache_prefetch(&proj.levels[index - 1]);
+    }
+    if (index + 1 < (ptrdiff_t)proj.level_count) {
+        level_cache_prefetch(&proj.levels[index + 1]);
+    }
+}
+
+static int level_stream_worker(void* data)
+{
+    level_stream_job* job = &stream.job;
+
+    job->result = TX_SUCCESS;
+    if (job->type == LEVEL_STREAM_PROJECT) {
+        job->result = load_level_project(&job->proj);
+    }
+
+    if (job->result == TX_SUCCESS) {
+        // proj and its index only change in level_stream_swap, never while a job runs
+        job->level = (job->type == LEVEL_STREAM_PROJECT) ? find_level(&job->proj, job->level_id)
+                                                         : level_find_id(job->level_id);
+        if (job->level) {
+            build_level_chunks(job->level, &job->builds);
+            for (int slot = 0; slot < LEVEL_CACHE_SLOT_COUNT; ++slot) {
+                if (slot != LEVEL_CACHE_SLOT_RENDER_CHUNKS) {
+                    job->slots[slot] = level_cache_build(
+                        job->level,
+                        (level_cache_slot)slot,
+                        &job->slot_bytes[slot]);
+                }
+            }
+        }
+    }
+
+    SDL_AtomicSet(&stream.done, 1);
+    return 0;
+}
+
+static void free_job_slots(level_stream_job* job)
+{
+    for (int slot = 0; slot < LEVEL_CACHE_SLOT_COUNT; ++slot) {
+        level_cache_discard((level_cache_slot)slot, job->slots[slot]);
+        job->slots[slot] = NULL;
+    }
+}
+
+static void level_stream_start(const level_stream_job* job)
+{
+    stream.job = *job;
+    SDL_AtomicSet(&stream.done, 0);
+    stream.thread = SDL_CreateThread(level_stream_worker, "level stream", NULL);
+    if (!stream.thread) {
+        // no thread to spare, do the work now rather than dropping the request
+        level_stream_worker(NULL);
+    }
+}
+
+static void level_stream_request(level_stream_type type, strhash level_id)
 {
-    strhash level_id = (strhash){0};
+    level_stream_job job = {.type = type, .level_id = level_id};
+
+    // a pending project reload still has to happen even if a level change is requested after it
+    if (stream.pending.type == LEVEL_STREAM_PROJECT) {
+        job.type = LEVEL_STREAM_PROJECT;
+    }
+
+    if (stream.thread || SDL_AtomicGet(&stream.done)) {
+        stream.pending = job;
+    } else {
+        level_stream_start(&job);
+    }
+}
+
+// Swaps in the finished job, the only place the project and active level change after init.
+static void level_stream_swap(level_stream_job* job)
+{
+    if (job->result != TX_SUCCESS) {
+        printf("level streaming failed to load the level project.\n");
+        free_game_level_project(&job->proj);
+        free_chunk_builds(&job->builds);
+        free_job_slots(job);
+        return;
+    }
+
     if (active) {
-        level_id = active->name_id;
         game_systems_unload_level();
         active = NULL;
     }
-    free_game_level_project(&proj);
-    load_game_level_project("assets/test_level.json", &proj);
-    level_load_id(level_id);
+
+    if (job->type == LEVEL_STREAM_PROJECT) {
+        // cached state points into the old project
+        level_cache_clear();
+        free_game_level_project(&proj);
+        proj = job->proj;
+        job->proj = (game_level_proj){0};
+        index_levels();
+    }
+
+    if (job->level) {
+        stream.ready = job->builds;
+        stream.ready_level = job->level;
+        job->builds = NULL;
+
+        // nothing holds on to the level's cached slots between unload and load, replacing them
+        // leaves the systems nothing to build on the main thread
+        for (int slot = 0; slot < LEVEL_CACHE_SLOT_COUNT; ++slot) {
+            if (job->slots[slot]) {
+                level_cache_put(
+                    job->level,
+                    (level_cache_slot)slot,
+                    job->slots[slot],
+                    job->slot_bytes[slot]);
+                job->slots[slot] = NULL;
+            }
+        }
+
+        game_systems_load_level(job->level);
+    }
+}
+
+static void level_stream_finish(void)
+{
+    if (stream.thread) {
+        SDL_WaitThread(stream.thread, NULL);
+        stream.thread = NULL;
+    }
+    SDL_AtomicSet(&stream.done, 0);
+}
+
+void on_change_level(event_message* message)
+{
+    change_level_event* change_level = (change_level_event*)message;
+    level_stream_request(LEVEL_STREAM_LEVEL, change_level->level_id);
+}
+
+void on_reload_level_proj(event_message* message)
+{
+    // reload whichever level will be active by the time the reload is swapped in
+    strhash level_id = active ? active->name_id : (strhash){0};
+    if (stream.pending.type != LEVEL_STREAM_NONE) {
+        level_id = stream.pending.level_id;
+    } else if (stream.thread || SDL_AtomicGet(&stream.done)) {
+        level_id = stream.job.level_id;
+    }
+    level_stream_request(LEVEL_STREAM_PROJECT, level_id);
 }
 
 tx_result level_system_init(game_settings* settings)
 {
-    tx_result ret = load_game_level_project("assets/test_level.json", &proj);
+    tx_result ret = load_level_project(&proj);
 
     if (ret != TX_SUCCESS) {
         return ret;
     }
 
+    index_levels();
+
+    level_cache_register(LEVEL_CACHE_SLOT_RENDER_CHUNKS, build_render_chunks, free_render_chunks);
+    if (settings->options.memory.level_cache_budget_kb > 0) {
+        level_cache_set_budget((size_t)settings->options.memory.level_cache_budget_kb * 1024);
+    }
+
     event_system_subscribe(EventMessage_ChangeLevel, on_change_level);
     event_system_subscribe(EventMessage_ReloadLevelProject, on_reload_level_proj);
 
@@ -50,48 +404,84 @@ tx_result level_system_init(game_settings* settings)
 
 void level_system_term(void)
 {
+    if (stream.thread || SDL_AtomicGet(&stream.done)) {
+        level_stream_finish();
+        free_game_level_project(&stream.job.proj);
+        free_chunk_builds(&stream.job.builds);
+        free_job_slots(&stream.job);
+    }
+    stream.pending = (level_stream_job){0};
+
+    level_system_unload_level();
+    free_chunk_builds(&stream.ready);
+    stream.ready_level = NULL;
+    level_cache_term();
+    hmfree(level_indices);
     free_game_level_project(&proj);
 }
 
+void level_system_update(float dt)
+{
+    if (SDL_AtomicGet(&stream.done)) {
+        level_stream_finish();
+        level_stream_swap(&stream.job);
+
+        if (stream.pending.type != LEVEL_STREAM_NONE) {
+            level_stream_job pending = stream.pending;
+            stream.pending = (level_stream_job){0};
+            level_stream_start(&pending);
+        }
+    }
+
+    // prefetching builds with the same procs as the worker, their stb_ds lookups aren't safe to
+    // run on two threads at once
+    if (!stream.thread) {
+        level_cache_update();
+    }
+}
+
 void level_system_load_level(game_level* level)
 {
     active = level;
+    level_cache_set_active(level);
+
+    // levels swapped in by streaming have their chunks built already, only the upload is left
+    if (level == stream.ready_level) {
+        if (!level_cache_contains(level, LEVEL_CACHE_SLOT_RENDER_CHUNKS)) {
+            size_t bytes = 0;
+            level_chunk_set* set = create_chunk_set(stream.ready, &bytes);
+            level_cache_put(level, LEVEL_CACHE_SLOT_RENDER_CHUNKS, set, bytes);
+        }
+        free_chunk_builds(&stream.ready);
+        stream.ready_level = NULL;
+    }
+
+    active_chunks = level_cache_acquire(level, LEVEL_CACHE_SLOT_RENDER_CHUNKS);
+
+    prefetch_neighbours(level);
 }
 
 void level_system_unload_level(void)
 {
+    // the chunks stay in the level cache
+    active_chunks = NULL;
     active = NULL;
 }
 
 void level_system_render(float ft)
 {
-    if (active) {
-        for (int lid = 0; lid < arrlen(active->layer_insts); ++lid) {
-            game_layer_inst layer = active->layer_insts[lid];
-            for (uint32_t x = 0; x < layer.cell_w; x++) {
-                for (uint32_t y = 0; y < layer.cell_h; y++) {
-                    if (layer.type != GAME_LAYER_TYPE_TILES) {
-                        continue;
-                    }
-                    game_tile tile = layer.tiles[x + y * layer.cell_w];
-                    int id = tile.value;
-                    sprite_flip flip = SPRITE_FLIP_NONE;
-                    if ((tile.flags & GAME_TILE_FLAGS_FLIP_X) != 0) {
-                        flip |= SPRITE_FLIP_X;
-                    }
-                    if ((tile.flags & GAME_TILE_FLAGS_FILP_Y) != 0) {
-                        flip |= SPRITE_FLIP_Y;
-                    }
+    vec2 view_min, view_max;
+    spr_get_view_bounds(&view_min, &view_max);
 
-                    if (id > 0) {
-                        spr_draw(&(sprite_draw_desc){
-                            .sprite_id = id,
-                            .pos = (vec2){.x = (float)x, .y = (float)y},
-                            .flip = flip,
-                        });
-                    }
-                }
-            }
+    if (!active_chunks) {
+        return;
+    }
+
+    for (int i = 0; i < arrlen(active_chunks->chunks); ++i) {
+        const level_chunk* chunk = &active_chunks->chunks[i];
+        if (chunk->max.x > view_min.x && chunk->min.x < view_max.x && chunk->max.y > view_min.y
+            && chunk->min.y < view_max.y) {
+            spr_draw_batch(chunk->batch);
         }
     }
 }
@@ -125,12 +515,8 @@ void level_system_reload_project(void)
 
 game_level* level_find_id(strhash id)
 {
-    for (int i = 0; i < arrlen(proj.levels); ++i) {
-        if (proj.levels[i].name_id.value == id.value) {
-            return &proj.levels[i];
-        }
-    }
-    return NULL;
+    ptrdiff_t index = hmgeti(level_indices, id.value);
+    return (index >= 0) ? &proj.levels[level_indices[index].value] : NULL;
 }
 
 #define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
@@ -144,7 +530,7 @@ void level_select_window(bool* show)
         }
         igSeparator();
         igBeginGroupPanel("Level Select", (ImVec2){0});
-        for (int i = 0; i < arrlen(proj.levels); ++i) {
+        for (uint32_t i = 0; i < proj.level_count; ++i) {
             game_level* level = &proj.levels[i];
             if (igButton(strhash_cstr(level->name_id), (ImVec2){0})) {
                 next_level = level;
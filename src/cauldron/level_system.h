@@ -8,6 +8,7 @@ tx_result level_system_init(game_settings* settings);
 void level_system_term(void);
 void level_system_load_level(game_level* level);
 void level_system_unload_level(void);
+void level_system_update(float dt);
 void level_system_render(float ft);
 void level_reload(void);
 void level_load_name(char* name);
@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "flecs.h"
@@ -67,24 +68,78 @@ void actor_move(ecs_iter_t* it)
     }
 }
 
+// Parses a level project and writes it out as a level pack that the level system maps directly.
+static int cook_level(const char* project_path, const char* pack_path)
+{
+    game_level_proj proj = {0};
+    tx_result ret = load_game_level_project(project_path, &proj);
+    if (ret == TX_SUCCESS) {
+        ret = save_game_level_pack(pack_path, &proj);
+    }
+    free_game_level_project(&proj);
+
+    if (ret != TX_SUCCESS) {
+        printf("failed to cook '%s' into '%s'.\n", project_path, pack_path);
+        return 1;
+    }
+
+    printf("cooked '%s' into '%s'.\n", project_path, pack_path);
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
     strhash_init();
     load_game_settings(NULL);
     game_settings* const settings = get_game_settings();
 
+    // --headless <frames>: run a fixed number of uncapped frames without a window and report the
+    // average frame time, used to benchmark render preparation on machines with no display
+    // --threads <count>: flecs worker threads, headless only as systems that touch the GL context
+    // would otherwise run on a worker thread
+    // --cook-level <project.json> <out.lvlpack>: cook a level pack and exit
+    bool headless = false;
+    int headless_frames = 0;
+    int threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+            headless_frames = (i + 1 < argc) ? atoi(argv[i + 1]) : 0;
+            headless_frames = (headless_frames > 0) ? headless_frames : 1000;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--cook-level") == 0 && i + 2 < argc) {
+            return cook_level(argv[i + 1], argv[i + 2]);
+        }
+    }
+
+    sdl2_set_ecs_os_api();
     ecs_world_t* world = ecs_init_w_args(argc, argv);
-    ecs_set_target_fps(world, 144.0f);
 
     ECS_IMPORT(world, CommonGameComponents);
-    ECS_IMPORT(world, SystemSdl2);
-    ECS_IMPORT(world, SystemSdl2Window);
 
-    ecs_entity_t window =
-        ecs_set(world, 0, WindowDesc, {.title = "cauldron", .width = 1280, .height = 720});
+    if (headless) {
+        ECS_IMPORT(world, SystemSpriteRendererHeadless);
+
+        if (threads > 1) {
+            ecs_set_threads(world, threads);
+        }
+    } else {
+        ecs_set_target_fps(world, 144.0f);
+
+        ECS_IMPORT(world, SystemSdl2);
+        ECS_IMPORT(world, SystemSdl2Window);
+
+        ecs_entity_t window =
+            ecs_set(world, 0, WindowDesc, {.title = "cauldron", .width = 1280, .height = 720});
+    }
 
+    // already imported in headless mode, this only fetches the component handles
     ECS_IMPORT(world, SystemSpriteRenderer);
 
+    float budget_ms = settings->options.video.dynamic_resolution_budget_ms;
+    spr_set_dynamic_resolution(budget_ms > 0.0f, budget_ms);
+
     ECS_COMPONENT(world, PlayerControlId);
 
     ECS_SYSTEM(
@@ -108,7 +163,18 @@ int main(int argc, char* argv[])
         SpriteDraw,
         {.sprite_id = 1, .origin = {0.5f, 0.5f}, .layer = -5.0f, .flip = 0});
 
-    while (ecs_progress(world, 0.0f)) {
+    ecs_set(world, 0, SpriteCamera, {.zoom = 1.0f, .follow = MyEnt});
+
+    if (headless) {
+        uint64_t start = get_ticks();
+        for (int i = 0; i < headless_frames; ++i) {
+            ecs_progress(world, 1.0f / 60.0f);
+        }
+        double ms = (double)(get_ticks() - start) * 1000.0 / get_frequency();
+        printf("headless: %d frames, %.3f ms/frame\n", headless_frames, ms / headless_frames);
+    } else {
+        while (ecs_progress(world, 0.0f)) {
+        }
     }
 
     return ecs_fini(world);
@@ -153,6 +219,11 @@ int main(int argc, char* argv[])
     //             },
     //         [4] =
     //             {
+    //                 .menu_path = "Debug/Render Stats",
+    //                 .window_proc = spr_render_stats_window,
+    //             },
+    //         [5] =
+    //             {
     //                 .menu_path = "Misc/Demo Window",
     //                 .window_proc = igShowDemoWindow,
     //             },
@@ -1,31 +1,88 @@
 #include "phys_system.h"
 
 #include "game_level.h"
+#include "level_cache.h"
 #include "stb_ds.h"
 #include "tx_math.h"
 
-typedef struct tile_phys {
-    uint16_t layer;
-    phys_tile_shape shape;
-} tile_phys;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PHYS_SIMD_SSE2
+#include <emmintrin.h>
+#endif
 
 typedef struct tile_shapes {
     uint32_t key;
     phys_tile_shape shape;
 } tile_phys_ref;
 
+// One bit per cell for the tiles of a single collision layer, rows are padded to whole words.
+typedef struct phys_plane {
+    uint16_t layer;
+    uint16_t layer_bit; // bit of the layer in a layer mask
+    uint64_t* full;     // tiles solid across the whole cell
+    uint64_t* partial;  // tiles whose shape in phys_grid.shapes has to be checked
+} phys_plane;
+
+// a level's collision tiles, cached per level and borrowed by the system while it's loaded
+typedef struct phys_grid {
+    uint32_t w, h;
+    uint32_t row_words;
+    phys_plane* planes; // stbds_arr, one per layer used by the level
+    uint8_t* shapes;    // packed phys_tile_shape of each cell, see pack_shape
+} phys_grid;
+
 enum flip { FLIP_NONE, FLIP_X, FLIP_Y };
 
+// tile space extents of the partial tile shapes
+#define K_PHYS_PLATFORM_DEPTH 0.3755f
+#define K_PHYS_WALL_MIN 0.375f
+#define K_PHYS_WALL_MAX 0.625f
+
+// how far behind the leading edge of a sweep a surface still counts as touched
+#define K_PHYS_CONTACT_EPSILON 0.0001f
+
 inline uint32_t tile_flip_key(uint16_t value, enum flip flip)
 {
     return (uint32_t)(value + ((uint32_t)flip << 16));
 }
 
-tile_phys* tiles = NULL;
+const phys_grid* active_phys_grid = NULL;
 tile_phys_ref* tile_phys_map = NULL;
-uint32_t tiles_w = 0, tiles_h = 0;
 float gravity = 50.0f;
 
+static uint8_t pack_shape(phys_tile_shape shape)
+{
+    return (uint8_t)(shape.type | (shape.flips << 2));
+}
+
+static phys_tile_shape unpack_shape(uint8_t packed)
+{
+    return (phys_tile_shape){
+        .type = (phys_tile_shape_type)(packed & 0x3),
+        .flips = (uint8_t)(packed >> 2),
+    };
+}
+
+static phys_plane* get_plane(phys_grid* grid, uint16_t layer)
+{
+    for (int i = 0; i < arrlen(grid->planes); ++i) {
+        if (grid->planes[i].layer == layer) {
+            return &grid->planes[i];
+        }
+    }
+
+    size_t words = (size_t)grid->row_words * grid->h;
+    arrput(
+        grid->planes,
+        ((phys_plane){
+            .layer = layer,
+            .layer_bit = (uint16_t)(1 << (layer - 1)),
+            .full = calloc(words, sizeof(uint64_t)),
+            .partial = calloc(words, sizeof(uint64_t)),
+        }));
+    return &arrlast(grid->planes);
+}
+
 void set_tile_shape(uint32_t tile_id, phys_tile_shape_type shape_type)
 {
     for (int flip = 0; flip < 4; ++flip) {
@@ -42,11 +99,78 @@ void set_tile_shape(uint32_t tile_id, phys_tile_shape_type shape_type)
     }
 }
 
+static void* build_phys_grid(const game_level* level, size_t* bytes)
+{
+    phys_grid* grid = calloc(1, sizeof(phys_grid));
+
+    const game_layer_inst* coll_layer = NULL;
+    const game_layer_inst* tile_layer = NULL;
+    for (uint32_t i = 0; i < level->layer_count; ++i) {
+        const game_layer_inst* layer = &level->layer_insts[i];
+        if (!coll_layer && layer->type == GAME_LAYER_TYPE_INTGRID) {
+            coll_layer = layer;
+        }
+        if (!tile_layer && layer->type == GAME_LAYER_TYPE_TILES) {
+            tile_layer = layer;
+        }
+    }
+
+    if (coll_layer && tile_layer) {
+        grid->w = coll_layer->cell_w;
+        grid->h = coll_layer->cell_h;
+        grid->row_words = (grid->w + 63) / 64;
+        grid->shapes = calloc((size_t)grid->w * grid->h, sizeof(uint8_t));
+
+        for (uint32_t y = 0; y < grid->h; ++y) {
+            for (uint32_t x = 0; x < grid->w; ++x) {
+                size_t i = x + (size_t)y * grid->w;
+                uint16_t layer = coll_layer->tiles[i].value;
+                if (layer == 0 || layer > 16) {
+                    continue;
+                }
+
+                uint16_t flips = tile_layer->tiles[i].flags & 0x3;
+                uint32_t key = tile_flip_key(tile_layer->tiles[i].value, flips);
+                tile_phys_ref phys_ref = stbds_hmgets(tile_phys_map, key);
+
+                phys_plane* plane = get_plane(grid, layer);
+                size_t word = (size_t)y * grid->row_words + (x >> 6);
+                uint64_t bit = 1ull << (x & 63);
+                if (phys_ref.shape.type == PHYS_TILE_SHAPE_FULL_TILE) {
+                    plane->full[word] |= bit;
+                } else {
+                    plane->partial[word] |= bit;
+                    grid->shapes[i] = pack_shape(phys_ref.shape);
+                }
+            }
+        }
+    }
+
+    size_t plane_bytes = sizeof(uint64_t) * 2 * grid->row_words * grid->h;
+    *bytes = sizeof(phys_grid) + (size_t)grid->w * grid->h
+             + (sizeof(phys_plane) + plane_bytes) * arrlen(grid->planes);
+    return grid;
+}
+
+static void free_phys_grid(void* data)
+{
+    phys_grid* grid = (phys_grid*)data;
+    for (int i = 0; i < arrlen(grid->planes); ++i) {
+        free(grid->planes[i].full);
+        free(grid->planes[i].partial);
+    }
+    arrfree(grid->planes);
+    free(grid->shapes);
+    free(grid);
+}
+
 tx_result phys_system_init(game_settings* settings)
 {
     set_tile_shape(61, PHYS_TILE_SHAPE_SLOPE);
     set_tile_shape(60, PHYS_TILE_SHAPE_PLATFORM);
 
+    level_cache_register(LEVEL_CACHE_SLOT_PHYS_GRID, build_phys_grid, free_phys_grid);
+
     return TX_SUCCESS;
 }
 
@@ -57,42 +181,13 @@ void phys_system_term(void)
 
 void phys_system_load_level(game_level* level)
 {
-    game_layer_inst* coll_layer = NULL;
-    game_layer_inst* tile_layer = NULL;
-    for (int i = 0; i < arrlen(level->layer_insts); ++i) {
-        game_layer_inst* layer = &level->layer_insts[i];
-        if (!coll_layer && layer->type == GAME_LAYER_TYPE_INTGRID) {
-            coll_layer = layer;
-        }
-        if (!tile_layer && layer->type == GAME_LAYER_TYPE_TILES) {
-            tile_layer = layer;
-        }
-    }
-
-    tiles_w = coll_layer->cell_w;
-    tiles_h = coll_layer->cell_h;
-    size_t len = arrlen(coll_layer->tiles);
-    arrsetlen(tiles, len);
-    memset(tiles, 0, sizeof(tile_phys) * len);
-
-    for (size_t i = 0; i < len; ++i) {
-        game_tile* coll_tile = &coll_layer->tiles[i];
-        uint16_t layer = coll_tile->value;
-        uint16_t flips = tile_layer->tiles[i].flags & 0x3;
-        uint32_t key = tile_flip_key(tile_layer->tiles[i].value, flips);
-        tile_phys_ref phys_ref = stbds_hmgets(tile_phys_map, key);
-        tiles[i] = (tile_phys){
-            .layer = layer,
-            .shape = phys_ref.shape,
-        };
-    }
+    active_phys_grid = level_cache_acquire(level, LEVEL_CACHE_SLOT_PHYS_GRID);
 }
 
 void phys_system_unload_level(void)
 {
-    arrfree(tiles);
-    tiles_w = 0;
-    tiles_h = 0;
+    // the grid stays in the level cache
+    active_phys_grid = NULL;
 }
 
 void phys_system_update(float dt)
@@ -110,9 +205,9 @@ bool _phys_shape_solid(phys_tile_shape shape, float nx, float ny)
     case PHYS_TILE_SHAPE_FULL_TILE:
         return true;
     case PHYS_TILE_SHAPE_PLATFORM:
-        return ny <= 0.3755f;
+        return ny <= K_PHYS_PLATFORM_DEPTH;
     case PHYS_TILE_SHAPE_WALL:
-        return nx >= 0.375f && nx < 0.625f;
+        return nx >= K_PHYS_WALL_MIN && nx < K_PHYS_WALL_MAX;
     case PHYS_TILE_SHAPE_SLOPE:
         switch (shape.flips) {
         default:
@@ -128,19 +223,533 @@ bool _phys_shape_solid(phys_tile_shape shape, float nx, float ny)
     }
 }
 
+// Finds the tile in a cell on one of the masked layers, a cell holds at most one tile so the first
+// plane with its bit set has it.
+static bool get_cell(int x, int y, uint16_t layer_mask, uint16_t* layer, phys_tile_shape* shape)
+{
+    const phys_grid* grid = active_phys_grid;
+    size_t word = (size_t)y * grid->row_words + (x >> 6);
+    uint64_t bit = 1ull << (x & 63);
+
+    for (int i = 0; i < arrlen(grid->planes); ++i) {
+        const phys_plane* plane = &grid->planes[i];
+        if ((plane->layer_bit & layer_mask) == 0) {
+            continue;
+        }
+        if ((plane->full[word] & bit) != 0) {
+            *layer = plane->layer;
+            *shape = (phys_tile_shape){.type = PHYS_TILE_SHAPE_FULL_TILE};
+            return true;
+        }
+        if ((plane->partial[word] & bit) != 0) {
+            *layer = plane->layer;
+            *shape = unpack_shape(grid->shapes[x + (size_t)y * grid->w]);
+            return true;
+        }
+    }
+    return false;
+}
+
 bool phys_solid(float x, float y, uint16_t layer_mask)
 {
-    if (x < 0.0f || y < 0.0f || x >= tiles_w || y >= tiles_h) {
+    const phys_grid* grid = active_phys_grid;
+    if (!grid || x < 0.0f || y < 0.0f || x >= grid->w || y >= grid->h) {
         return false;
     }
 
     int ix = (int)x;
     int iy = (int)y;
 
-    tile_phys* tp = &tiles[ix + iy * tiles_w];
-    uint16_t layer = tp->layer;
-    return layer > 0 && ((1 << (layer - 1)) & layer_mask) != 0
-           && _phys_shape_solid(tp->shape, x - ix, y - iy);
+    uint16_t layer;
+    phys_tile_shape shape;
+    return get_cell(ix, iy, layer_mask, &layer, &shape)
+           && _phys_shape_solid(shape, x - ix, y - iy);
+}
+
+#ifdef PHYS_SIMD_SSE2
+// Tests four points. There is no gather for the planes so the cell lookups stay scalar, the bounds
+// checks, cell coordinates and shape tests are done for all four lanes at once.
+static uint32_t solid_points4(const vec2* points, uint16_t layer_mask)
+{
+    const phys_grid* grid = active_phys_grid;
+
+    __m128 p01 = _mm_loadu_ps(&points[0].x);
+    __m128 p23 = _mm_loadu_ps(&points[2].x);
+    __m128 xs = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 ys = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3, 1, 3, 1));
+
+    __m128 zero = _mm_setzero_ps();
+    __m128 in_min = _mm_and_ps(_mm_cmpge_ps(xs, zero), _mm_cmpge_ps(ys, zero));
+    __m128 in_max = _mm_and_ps(
+        _mm_cmplt_ps(xs, _mm_set1_ps((float)grid->w)),
+        _mm_cmplt_ps(ys, _mm_set1_ps((float)grid->h)));
+    int lanes = _mm_movemask_ps(_mm_and_ps(in_min, in_max));
+    if (lanes == 0) {
+        return 0;
+    }
+
+    __m128i ixs = _mm_cvttps_epi32(xs);
+    __m128i iys = _mm_cvttps_epi32(ys);
+    int32_t ix[4], iy[4];
+    _mm_storeu_si128((__m128i*)ix, ixs);
+    _mm_storeu_si128((__m128i*)iy, iys);
+
+    uint32_t full = 0, partial = 0;
+    int32_t types[4] = {-1, -1, -1, -1};
+    int32_t flips[4] = {0};
+    for (int lane = 0; lane < 4; ++lane) {
+        uint16_t layer;
+        phys_tile_shape shape;
+        if ((lanes & (1 << lane)) == 0
+            || !get_cell(ix[lane], iy[lane], layer_mask, &layer, &shape)) {
+            continue;
+        }
+
+        if (shape.type == PHYS_TILE_SHAPE_FULL_TILE) {
+            full |= 1u << lane;
+        } else {
+            partial |= 1u << lane;
+            types[lane] = shape.type;
+            flips[lane] = shape.flips;
+        }
+    }
+
+    if (partial == 0) {
+        return full;
+    }
+
+    // every shape's test for every lane, each lane then keeps the one for its own shape
+    __m128 nx = _mm_sub_ps(xs, _mm_cvtepi32_ps(ixs));
+    __m128 ny = _mm_sub_ps(ys, _mm_cvtepi32_ps(iys));
+    __m128 inv_ny = _mm_sub_ps(_mm_set1_ps(1.0f), ny);
+
+    __m128 platform = _mm_cmple_ps(ny, _mm_set1_ps(K_PHYS_PLATFORM_DEPTH));
+    __m128 wall = _mm_and_ps(
+        _mm_cmpge_ps(nx, _mm_set1_ps(K_PHYS_WALL_MIN)),
+        _mm_cmplt_ps(nx, _mm_set1_ps(K_PHYS_WALL_MAX)));
+    __m128 slopes[4] = {
+        _mm_cmpge_ps(nx, inv_ny),
+        _mm_cmple_ps(nx, ny),
+        _mm_cmpge_ps(nx, ny),
+        _mm_cmple_ps(nx, inv_ny),
+    };
+
+    __m128i type_v = _mm_loadu_si128((const __m128i*)types);
+    __m128i flip_v = _mm_loadu_si128((const __m128i*)flips);
+    __m128 is_platform =
+        _mm_castsi128_ps(_mm_cmpeq_epi32(type_v, _mm_set1_epi32(PHYS_TILE_SHAPE_PLATFORM)));
+    __m128 is_wall =
+        _mm_castsi128_ps(_mm_cmpeq_epi32(type_v, _mm_set1_epi32(PHYS_TILE_SHAPE_WALL)));
+    __m128 is_slope =
+        _mm_castsi128_ps(_mm_cmpeq_epi32(type_v, _mm_set1_epi32(PHYS_TILE_SHAPE_SLOPE)));
+
+    __m128 slope = _mm_setzero_ps();
+    for (int flip = 0; flip < 4; ++flip) {
+        __m128 is_flip = _mm_castsi128_ps(_mm_cmpeq_epi32(flip_v, _mm_set1_epi32(flip)));
+        slope = _mm_or_ps(slope, _mm_and_ps(is_flip, slopes[flip]));
+    }
+
+    __m128 solid = _mm_or_ps(
+        _mm_or_ps(_mm_and_ps(is_platform, platform), _mm_and_ps(is_wall, wall)),
+        _mm_and_ps(is_slope, slope));
+    return full | ((uint32_t)_mm_movemask_ps(solid) & partial);
+}
+#endif
+
+uint32_t phys_solid_points(const vec2* points, uint32_t count, uint16_t layer_mask)
+{
+    TX_ASSERT(count <= PHYS_SOLID_BATCH_MAX);
+
+    if (!active_phys_grid) {
+        return 0;
+    }
+
+    uint32_t result = 0;
+    uint32_t i = 0;
+#ifdef PHYS_SIMD_SSE2
+    for (; i + 4 <= count; i += 4) {
+        result |= solid_points4(&points[i], layer_mask) << i;
+    }
+#endif
+    for (; i < count; ++i) {
+        if (phys_solid(points[i].x, points[i].y, layer_mask)) {
+            result |= 1u << i;
+        }
+    }
+    return result;
+}
+
+uint32_t phys_solid_aabb_corners(vec2 min, vec2 max, uint16_t layer_mask)
+{
+    vec2 corners[4] = {
+        {.x = min.x, .y = min.y},
+        {.x = max.x, .y = min.y},
+        {.x = min.x, .y = max.y},
+        {.x = max.x, .y = max.y},
+    };
+    return phys_solid_points(corners, 4, layer_mask);
+}
+
+// Where within a cell, 0 to 1 along the axis, a box moving along it first touches the solid part of
+// the shape. [a, b] is the span of the box across the cell on the other axis, also 0 to 1. Boxes
+// moving in the positive direction touch the nearest solid point, boxes moving in the negative
+// direction the farthest. Returns false when the span misses the shape entirely.
+static bool _phys_shape_entry(
+    phys_tile_shape shape,
+    phys_axis axis,
+    bool positive,
+    float a,
+    float b,
+    float* entry)
+{
+    switch (shape.type) {
+    default:
+    case PHYS_TILE_SHAPE_FULL_TILE:
+        *entry = positive ? 0.0f : 1.0f;
+        return true;
+    case PHYS_TILE_SHAPE_PLATFORM:
+        if (axis == PHYS_AXIS_X) {
+            *entry = positive ? 0.0f : 1.0f;
+            return a <= K_PHYS_PLATFORM_DEPTH;
+        }
+        *entry = positive ? 0.0f : K_PHYS_PLATFORM_DEPTH;
+        return true;
+    case PHYS_TILE_SHAPE_WALL:
+        if (axis == PHYS_AXIS_X) {
+            *entry = positive ? K_PHYS_WALL_MIN : K_PHYS_WALL_MAX;
+            return true;
+        }
+        *entry = positive ? 0.0f : 1.0f;
+        return b >= K_PHYS_WALL_MIN && a < K_PHYS_WALL_MAX;
+    case PHYS_TILE_SHAPE_SLOPE:
+        // every flip is symmetric between the axes, see _phys_shape_solid for the solid halves
+        switch (shape.flips) {
+        default:
+        case 0:
+            *entry = positive ? 1.0f - b : 1.0f;
+            return true;
+        case 1:
+            if (axis == PHYS_AXIS_X) {
+                *entry = positive ? 0.0f : b;
+            } else {
+                *entry = positive ? a : 1.0f;
+            }
+            return true;
+        case 2:
+            if (axis == PHYS_AXIS_X) {
+                *entry = positive ? a : 1.0f;
+            } else {
+                *entry = positive ? 0.0f : b;
+            }
+            return true;
+        case 3:
+            *entry = positive ? 0.0f : 1.0f - a;
+            return true;
+        }
+    }
+}
+
+phys_sweep_hit phys_sweep_aabb(
+    vec2 min,
+    vec2 max,
+    phys_axis axis,
+    float delta,
+    uint16_t layer_mask)
+{
+    phys_sweep_hit result = {.dist = delta};
+    if (delta == 0.0f || !active_phys_grid) {
+        return result;
+    }
+
+    const int u = axis;
+    const int v = 1 - axis;
+    const float lo[2] = {min.x, min.y};
+    const float hi[2] = {max.x, max.y};
+    const int dims[2] = {(int)active_phys_grid->w, (int)active_phys_grid->h};
+
+    const bool positive = delta > 0.0f;
+    const float edge = positive ? hi[u] : lo[u];
+    const float target = edge + delta;
+
+    // rows the box covers across the sweep, a box with no extent still covers the row it's in
+    int v0 = (int)floorf(lo[v]);
+    int v1 = (int)ceilf(hi[v]) - 1;
+    v1 = (v1 > v0) ? v1 : v0;
+    v0 = (v0 > 0) ? v0 : 0;
+    v1 = (v1 < dims[v] - 1) ? v1 : dims[v] - 1;
+    if (v0 > v1) {
+        return result;
+    }
+
+    const int step = positive ? 1 : -1;
+    const int u_end = (int)floorf(target) + step;
+    for (int c = (int)floorf(edge); c != u_end; c += step) {
+        if (c < 0 || c >= dims[u]) {
+            continue;
+        }
+
+        // a surface further along the sweep can't be closer than one in an earlier cell, so the
+        // first cell with a contact has the nearest
+        bool found = false;
+        float contact = 0.0f;
+        for (int r = v0; r <= v1; ++r) {
+            uint16_t layer;
+            phys_tile_shape shape;
+            bool in_cell = (axis == PHYS_AXIS_X) ? get_cell(c, r, layer_mask, &layer, &shape)
+                                                 : get_cell(r, c, layer_mask, &layer, &shape);
+            if (!in_cell) {
+                continue;
+            }
+
+            float a = clampf(lo[v] - r, 0.0f, 1.0f);
+            float b = clampf(hi[v] - r, 0.0f, 1.0f);
+            float entry;
+            if (!_phys_shape_entry(shape, axis, positive, a, b, &entry)) {
+                continue;
+            }
+
+            float pos = c + entry;
+            bool ahead = positive ? pos >= edge - K_PHYS_CONTACT_EPSILON
+                                  : pos <= edge + K_PHYS_CONTACT_EPSILON;
+            bool reached = positive ? pos <= target : pos >= target;
+            bool nearer = !found || (positive ? pos < contact : pos > contact);
+            if (ahead && reached && nearer) {
+                found = true;
+                contact = pos;
+                result.layer = layer;
+                result.shape = shape;
+            }
+        }
+
+        if (found) {
+            result.hit = true;
+            result.dist = positive ? fmaxf(contact - edge, 0.0f) : fminf(contact - edge, 0.0f);
+            return result;
+        }
+    }
+
+    return result;
+}
+
+// A tile shape as half-planes n.p <= c in world space: the bounds of the shape within its cell
+// plus a diagonal for slopes. Every shape is convex with edges along these normals only, so
+// expanding each plane by a box's extent along its normal gives the exact Minkowski sum.
+typedef struct cast_planes {
+    float x0, x1, y0, y1;
+    bool diagonal;
+    vec2 n;
+    float c;
+} cast_planes;
+
+static cast_planes get_cast_planes(phys_tile_shape shape, int ix, int iy, vec2 h)
+{
+    const float k = 0.70710678f;
+
+    cast_planes planes = {.x0 = 0.0f, .x1 = 1.0f, .y0 = 0.0f, .y1 = 1.0f};
+    switch (shape.type) {
+    default:
+    case PHYS_TILE_SHAPE_FULL_TILE:
+        break;
+    case PHYS_TILE_SHAPE_PLATFORM:
+        planes.y1 = K_PHYS_PLATFORM_DEPTH;
+        break;
+    case PHYS_TILE_SHAPE_WALL:
+        planes.x0 = K_PHYS_WALL_MIN;
+        planes.x1 = K_PHYS_WALL_MAX;
+        break;
+    case PHYS_TILE_SHAPE_SLOPE:
+        // same solid halves as _phys_shape_solid
+        planes.diagonal = true;
+        switch (shape.flips) {
+        default:
+        case 0:
+            planes.n = (vec2){.x = -k, .y = -k};
+            planes.c = -k;
+            break;
+        case 1:
+            planes.n = (vec2){.x = k, .y = -k};
+            planes.c = 0.0f;
+            break;
+        case 2:
+            planes.n = (vec2){.x = -k, .y = k};
+            planes.c = 0.0f;
+            break;
+        case 3:
+            planes.n = (vec2){.x = k, .y = k};
+            planes.c = k;
+            break;
+        }
+        break;
+    }
+
+    planes.x0 += ix - h.x;
+    planes.x1 += ix + h.x;
+    planes.y0 += iy - h.y;
+    planes.y1 += iy + h.y;
+    planes.c += planes.n.x * ix + planes.n.y * iy;
+    planes.c += fabsf(planes.n.x) * h.x + fabsf(planes.n.y) * h.y;
+    return planes;
+}
+
+// Clips the ray against one plane, returns false once the ray is entirely outside of it.
+static bool clip_plane(vec2 n, float c, vec2 o, vec2 d, float* t_enter, float* t_exit, vec2* normal)
+{
+    float num = c - (n.x * o.x + n.y * o.y);
+    float denom = n.x * d.x + n.y * d.y;
+    if (denom == 0.0f) {
+        return num > 0.0f;
+    }
+
+    float t = num / denom;
+    if (denom < 0.0f) {
+        if (t >= *t_enter) {
+            *t_enter = t;
+            *normal = n;
+        }
+    } else if (t < *t_exit) {
+        *t_exit = t;
+    }
+    return *t_enter < *t_exit;
+}
+
+// Tests the ray from o against the tile in a cell expanded by h, keeping it in best when it's
+// nearer than what was hit so far.
+static void cast_cell(
+    int ix,
+    int iy,
+    vec2 o,
+    vec2 d,
+    vec2 h,
+    uint16_t layer_mask,
+    phys_cast_hit* best)
+{
+    uint16_t layer;
+    phys_tile_shape shape;
+    if (!get_cell(ix, iy, layer_mask, &layer, &shape)) {
+        return;
+    }
+
+    cast_planes planes = get_cast_planes(shape, ix, iy, h);
+
+    // limiting the exit to the nearest hit so far rejects anything further away. Entering from
+    // behind the origin keeps the normal of the face the ray came through when it starts inside.
+    float t_enter = -INFINITY;
+    float t_exit = best->dist;
+    vec2 normal = {0};
+    bool hit = clip_plane((vec2){.x = -1.0f}, -planes.x0, o, d, &t_enter, &t_exit, &normal)
+               && clip_plane((vec2){.x = 1.0f}, planes.x1, o, d, &t_enter, &t_exit, &normal)
+               && clip_plane((vec2){.y = -1.0f}, -planes.y0, o, d, &t_enter, &t_exit, &normal)
+               && clip_plane((vec2){.y = 1.0f}, planes.y1, o, d, &t_enter, &t_exit, &normal)
+               && (!planes.diagonal
+                   || clip_plane(planes.n, planes.c, o, d, &t_enter, &t_exit, &normal));
+    if (!hit || t_exit <= 0.0f) {
+        return;
+    }
+
+    t_enter = fmaxf(t_enter, 0.0f);
+    *best = (phys_cast_hit){
+        .hit = true,
+        .dist = t_enter,
+        .point = vec2_add(o, vec2_scale(d, t_enter)),
+        .normal = normal,
+        .cell_x = ix,
+        .cell_y = iy,
+        .layer = layer,
+        .shape = shape,
+    };
+}
+
+static phys_cast_hit cast(vec2 o, vec2 h, vec2 dir, float max_dist, uint16_t layer_mask)
+{
+    phys_cast_hit result = {.dist = max_dist};
+    float len = vec2_len(dir);
+    if (!active_phys_grid || len == 0.0f || max_dist <= 0.0f) {
+        result.point = o;
+        return result;
+    }
+
+    const vec2 d = vec2_scale(dir, 1.0f / len);
+    result.point = isfinite(max_dist) ? vec2_add(o, vec2_scale(d, max_dist)) : o;
+
+    // walk columns along the major axis u, each column covers the rows the box passes through
+    // while it overlaps the column
+    const int u = (fabsf(d.x) >= fabsf(d.y)) ? 0 : 1;
+    const int v = 1 - u;
+    const float ou[2] = {o.x, o.y};
+    const float hu[2] = {h.x, h.y};
+    const float du[2] = {d.x, d.y};
+    const int dims[2] = {(int)active_phys_grid->w, (int)active_phys_grid->h};
+
+    // clip the cast to the time the box overlaps the grid first, so an unbounded max_dist or an
+    // origin far outside the grid neither overflows the column range nor walks empty columns
+    float t_min = 0.0f;
+    float t_max = max_dist;
+    for (int a = 0; a < 2; ++a) {
+        float lo = ou[a] - hu[a];
+        float hi = ou[a] + hu[a];
+        if (du[a] == 0.0f) {
+            if (hi <= 0.0f || lo >= dims[a]) {
+                return result;
+            }
+            continue;
+        }
+        t_min = fmaxf(t_min, (du[a] > 0.0f ? -hi : dims[a] - lo) / du[a]);
+        t_max = fminf(t_max, (du[a] > 0.0f ? dims[a] - lo : -hi) / du[a]);
+    }
+    if (!(t_min < t_max)) {
+        return result;
+    }
+
+    const bool positive = du[u] > 0.0f;
+    const int step = positive ? 1 : -1;
+    const float lo_u = ou[u] - hu[u];
+    const float hi_u = ou[u] + hu[u];
+    const float last_col = dims[u] - 1.0f;
+    const float begin_u = (positive ? lo_u : hi_u) + du[u] * t_min;
+    const float end_u = (positive ? hi_u : lo_u) + du[u] * t_max;
+    const int c_begin = (int)fminf(fmaxf(floorf(begin_u), 0.0f), last_col);
+    const int c_end = (int)fminf(fmaxf(floorf(end_u), 0.0f), last_col) + step;
+
+    for (int c = c_begin; c != c_end; c += step) {
+        // time the box spends overlapping the column
+        float t0 = positive ? (c - hi_u) / du[u] : (c + 1 - lo_u) / du[u];
+        float t1 = positive ? (c + 1 - lo_u) / du[u] : (c - hi_u) / du[u];
+        t0 = fmaxf(t0, t_min);
+        t1 = fminf(fminf(t1, t_max), result.dist);
+        if (t0 > result.dist) {
+            break;
+        }
+
+        const float last_row = dims[v] - 1.0f;
+        float v_min = ou[v] - hu[v] + fminf(du[v] * t0, du[v] * t1);
+        float v_max = ou[v] + hu[v] + fmaxf(du[v] * t0, du[v] * t1);
+        float f0 = floorf(v_min);
+        float f1 = fmaxf(ceilf(v_max) - 1.0f, f0);
+        int r0 = (int)fminf(fmaxf(f0, 0.0f), last_row);
+        int r1 = (int)fminf(fmaxf(f1, 0.0f), last_row);
+
+        for (int r = r0; r <= r1; ++r) {
+            if (u == 0) {
+                cast_cell(c, r, o, d, h, layer_mask, &result);
+            } else {
+                cast_cell(r, c, o, d, h, layer_mask, &result);
+            }
+        }
+    }
+
+    return result;
+}
+
+phys_cast_hit phys_raycast(vec2 origin, vec2 dir, float max_dist, uint16_t layer_mask)
+{
+    return cast(origin, (vec2){0}, dir, max_dist, layer_mask);
+}
+
+phys_cast_hit phys_cast_aabb(vec2 min, vec2 max, vec2 dir, float max_dist, uint16_t layer_mask)
+{
+    vec2 center = vec2_scale(vec2_add(min, max), 0.5f);
+    vec2 h = vec2_scale(vec2_sub(max, min), 0.5f);
+    return cast(center, h, dir, max_dist, layer_mask);
 }
 
 float phys_get_gravity()
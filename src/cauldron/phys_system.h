@@ -23,6 +23,37 @@ typedef struct phys_tile_shape {
     uint8_t flips;
 } phys_tile_shape;
 
+enum { PHYS_SOLID_BATCH_MAX = 32 };
+
+enum {
+    PHYS_CORNER_TOP_LEFT = 1 << 0,
+    PHYS_CORNER_TOP_RIGHT = 1 << 1,
+    PHYS_CORNER_BOTTOM_LEFT = 1 << 2,
+    PHYS_CORNER_BOTTOM_RIGHT = 1 << 3,
+};
+
+typedef enum phys_axis {
+    PHYS_AXIS_X = 0,
+    PHYS_AXIS_Y = 1,
+} phys_axis;
+
+typedef struct phys_sweep_hit {
+    bool hit;
+    float dist; // signed like the sweep delta, the full delta when nothing was hit
+    uint16_t layer;
+    phys_tile_shape shape;
+} phys_sweep_hit;
+
+typedef struct phys_cast_hit {
+    bool hit;
+    float dist;  // along the normalized direction, max_dist when nothing was hit
+    vec2 point;  // where a ray hit, or the center of a box when it made contact
+    vec2 normal; // against the face the cast came through, also when it started inside a tile
+    int32_t cell_x, cell_y;
+    uint16_t layer;
+    phys_tile_shape shape;
+} phys_cast_hit;
+
 tx_result phys_system_init(game_settings* settings);
 void phys_system_term(void);
 void phys_system_load_level(game_level* level);
@@ -31,4 +62,30 @@ void phys_system_update(float dt);
 void phys_system_render(float rt);
 
 bool phys_solid(float x, float y, uint16_t layer_mask);
+
+// Tests up to PHYS_SOLID_BATCH_MAX points, four at a time where SSE2 is available. Bit i of the
+// result is set when points[i] is solid.
+uint32_t phys_solid_points(const vec2* points, uint32_t count, uint16_t layer_mask);
+
+// Which corners of a box are solid as PHYS_CORNER_ flags, tested as a single batch.
+uint32_t phys_solid_aabb_corners(vec2 min, vec2 max, uint16_t layer_mask);
+
+// Sweeps a box along one axis through the tile grid and stops at the first tile whose shape it
+// touches, visiting each cell in its path once. Boxes with no extent across the axis are swept as a
+// segment or point. Solids the leading edge is already inside are passed through so boxes resting
+// in a slope or wall can move out of it.
+phys_sweep_hit phys_sweep_aabb(
+    vec2 min,
+    vec2 max,
+    phys_axis axis,
+    float delta,
+    uint16_t layer_mask);
+
+// Casts a ray or a box in any direction through the tile grid against the exact tile shapes. Cells
+// are walked a column at a time along the major axis of the direction, each cell in the path is
+// tested once and the walk stops at the first column past the nearest hit. Touching a tile without
+// moving into it is not a hit. A cast starting inside a tile hits it at dist 0. max_dist may be
+// INFINITY to cast until something is hit, the walk is limited to the grid either way.
+phys_cast_hit phys_raycast(vec2 origin, vec2 dir, float max_dist, uint16_t layer_mask);
+phys_cast_hit phys_cast_aabb(vec2 min, vec2 max, vec2 dir, float max_dist, uint16_t layer_mask);
 float phys_get_gravity();
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "shader_bundle.h"
+
+#include "futils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// premake generates the header before every build, builds without it read the shader files too
+#if !defined(_DEBUG) && __has_include("shader_bundle.gen.h")
+#include "shader_bundle.gen.h"
+#define SHADER_BUNDLE_EMBEDDED
+#endif
+
+#if !defined(SHADER_BUNDLE_EMBEDDED)
+
+// Development builds read assets/shaders so shaders can be edited without a rebuild
+
+struct {
+    uint8_t* data;
+    size_t len;
+    const shader_bundle_entry* entries;
+    uint32_t count;
+} bundle;
+
+void shader_bundle_init(void)
+{
+    if (read_binary_file_to_buffer(SHADER_BUNDLE_PATH, &bundle.data, &bundle.len) != TX_SUCCESS) {
+        return;
+    }
+
+    shader_bundle_header header = {0};
+    if (bundle.len >= sizeof(header)) {
+        memcpy(&header, bundle.data, sizeof(header));
+    }
+
+    bool valid = header.magic == SHADER_BUNDLE_MAGIC && header.version == SHADER_BUNDLE_VERSION &&
+                 sizeof(header) + sizeof(shader_bundle_entry) * header.count <= bundle.len;
+
+    const shader_bundle_entry* entries = (const shader_bundle_entry*)(bundle.data + sizeof(header));
+    for (uint32_t i = 0; valid && i < header.count; ++i) {
+        // sources must be null terminated within the file
+        valid = (size_t)entries[i].offset + entries[i].size < bundle.len &&
+                bundle.data[entries[i].offset + entries[i].size] == '\0';
+    }
+
+    if (!valid) {
+        printf("shader bundle '%s' is invalid, loading loose shaders.\n", SHADER_BUNDLE_PATH);
+        shader_bundle_term();
+        return;
+    }
+
+    bundle.entries = entries;
+    bundle.count = header.count;
+}
+
+void shader_bundle_term(void)
+{
+    free(bundle.data);
+    memset(&bundle, 0, sizeof(bundle));
+}
+
+char* shader_source_load(const char* name)
+{
+    for (uint32_t i = 0; i < bundle.count; ++i) {
+        if (strncmp(bundle.entries[i].name, name, SHADER_BUNDLE_NAME_LEN) == 0) {
+            return (char*)bundle.data + bundle.entries[i].offset;
+        }
+    }
+
+    char path[256];
+    snprintf(path, sizeof(path), "assets/shaders/%s", name);
+
+    char* source = NULL;
+    size_t len;
+    if (read_file_to_buffer(path, &source, &len) != TX_SUCCESS) {
+        return NULL;
+    }
+    return source;
+}
+
+void shader_source_free(char* source)
+{
+    // sources living in the bundle are released with it
+    bool in_bundle = bundle.data && (uint8_t*)source >= bundle.data &&
+                     (uint8_t*)source < bundle.data + bundle.len;
+    if (!in_bundle) {
+        free(source);
+    }
+}
+
+#else
+
+void shader_bundle_init(void)
+{
+}
+
+void shader_bundle_term(void)
+{
+}
+
+char* shader_source_load(const char* name)
+{
+    for (size_t i = 0; i < sizeof(k_embedded_shaders) / sizeof(k_embedded_shaders[0]); ++i) {
+        if (strcmp(k_embedded_shaders[i].name, name) == 0) {
+            return (char*)k_embedded_shaders[i].source;
+        }
+    }
+
+    printf("shader '%s' is not embedded, regenerate shader_bundle.gen.h.\n", name);
+    return NULL;
+}
+
+void shader_source_free(char* source)
+{
+    // embedded sources live in the binary
+    (void)source;
+}
+
+#endif
@@ -0,0 +1,49 @@
+// shader_bundle.h - Shader Bundle
+// Release builds compile the shader sources into the binary through shader_bundle.gen.h, which the
+// embed_shaders action in premake5.lua generates before every build, so startup does no shader file
+// I/O. Development builds, and builds without the generated header, read them from assets/shaders
+// so shaders can be edited without a rebuild, from the single bundle file asset_pipeline.ps1 writes
+// when there is one.
+
+#pragma once
+
+#include "tx_types.h"
+
+#define SHADER_BUNDLE_MAGIC 0x42444853 // "SHDB"
+#define SHADER_BUNDLE_VERSION 1
+#define SHADER_BUNDLE_PATH "assets/shaders/shaders.bundle"
+
+enum { SHADER_BUNDLE_NAME_LEN = 64 };
+
+// File layout, all values little endian:
+//   shader_bundle_header
+//   shader_bundle_entry[count]
+//   null terminated sources
+typedef struct shader_bundle_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+} shader_bundle_header;
+
+typedef struct shader_bundle_entry {
+    char name[SHADER_BUNDLE_NAME_LEN]; // file name within assets/shaders, e.g. sprite.vert
+    uint32_t offset;                   // from the start of the file
+    uint32_t size;                     // excluding the null terminator
+} shader_bundle_entry;
+
+// Entry of the k_embedded_shaders table in shader_bundle.gen.h
+typedef struct shader_embedded_source {
+    const char* name; // file name within assets/shaders, e.g. sprite.vert
+    const char* source;
+} shader_embedded_source;
+
+// Development builds load the bundle if one exists, shaders are read from their loose files
+// otherwise. Release builds with embedded sources touch no files.
+void shader_bundle_init(void);
+void shader_bundle_term(void);
+
+// Source of assets/shaders/<name>. Release builds return the embedded source, development builds
+// the bundle's copy when it has the shader and the loose file otherwise. Release with
+// shader_source_free.
+char* shader_source_load(const char* name);
+void shader_source_free(char* source);
@@ -0,0 +1,52 @@
+// sprite_atlas_format.h - Baked Sprite Atlas
+// binary rect table written by the atlas_packer tool and loaded directly by the sprite renderer
+
+#pragma once
+
+#include <stdint.h>
+
+#define SPRITE_ATLAS_MAGIC 0x534c5441 // "ATLS"
+#define SPRITE_ATLAS_VERSION 1
+
+enum { SPRITE_ATLAS_PATH_LEN = 64 };
+
+// File layout, all values little endian:
+//   sprite_atlas_header
+//   sprite_atlas_page[page_count]
+//   sprite_atlas_source[source_count]
+//   sprite_atlas_rect[sprite_count]
+typedef struct sprite_atlas_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t page_width; // every page has the same power of two size
+    uint32_t page_height;
+    uint32_t page_count;
+    uint32_t source_count;
+    uint32_t sprite_count;
+} sprite_atlas_header;
+
+// png file name of a page, relative to the directory holding the rect table
+typedef struct sprite_atlas_page {
+    char path[SPRITE_ATLAS_PATH_LEN];
+} sprite_atlas_page;
+
+// Source images are sliced into cells in row-major order and each cell takes the next sprite id,
+// sources keep the order they were given to the packer.
+typedef struct sprite_atlas_source {
+    char path[SPRITE_ATLAS_PATH_LEN];
+    uint32_t cell_w;
+    uint32_t cell_h;
+    uint32_t first_id;
+    uint32_t count;
+} sprite_atlas_source;
+
+// Texel rect of a sprite id within its page. Empty cells are not packed and have a zero size,
+// identical cells share the same rect.
+typedef struct sprite_atlas_rect {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint16_t page;
+    uint16_t pad;
+} sprite_atlas_rect;
@@ -1,42 +1,181 @@
 #include "sprite_draw.h"
 
 #include "futils.h"
+#include "gpu_timer.h"
+#include "shader_bundle.h"
+#include "sprite_atlas_format.h"
 #include "stb_image.h"
 #include "string.h"
+#include "system_pool.h"
+#include "system_window_sdl2.h"
 #include "window_system.h"
 
+#include <float.h>
+#include <stdio.h>
+
+#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#include <cimgui.h>
+
 // private system structs
 struct vertex {
     vec3 pos;
     vec2 uv;
 };
 
+// Packed per-instance data, decoded in sprite.vert. Positions and layers are stored as fixed point
+// (see K_SPRITE_POS_SCALE and K_SPRITE_LAYER_SCALE) and the atlas rect is looked up by sprite_id.
+// Animated instances offset sprite_id by the clip frame at the uniform time, their start time is
+// in wrapping ticks (see K_SPRITE_ANIM_TICKS) and their rate is 8.8 fixed point.
 struct sprite {
-    vec3 pos;
-    vec4 rect;
-    vec2 origin;
+    int16_t pos_x;
+    int16_t pos_y;
+    int16_t layer;
+    int16_t sprite_id;
+    uint8_t flags;    // bits 0-1: sprite_flip -- bits 2-3: sprite_anim_mode
+    uint8_t origin_x; // [0, 255] -> [0, 1]
+    uint8_t origin_y;
+    uint8_t frame_count;
+    uint16_t anim_start;
+    uint16_t anim_fps;
+};
+
+#define K_SPRITE_ANIM_MODE_SHIFT 2
+
+// Animation clock ticks per second. Tick counts wrap at 16 bits so loops skip a frame about every
+// 17 minutes, clips played once are resolved to their last frame on the CPU when drawn.
+#define K_SPRITE_ANIM_TICKS 64.0f
+#define K_SPRITE_ANIM_TICK_WRAP 65536.0f
+#define K_SPRITE_ANIM_FPS_SCALE 256.0f
+
+// fixed point steps per world unit, positions cover [-1024, 1024) with 1/32 unit precision
+#define K_SPRITE_POS_SCALE 32.0f
+#define K_SPRITE_LAYER_SCALE 8.0f
+
+// atlas texels covering one world unit
+#define K_TEXELS_PER_UNIT 8.0f
+
+// Where a sprite lives in the atlas texture array. The table is uploaded to the GPU as two RGBA32F
+// texels per sprite id so the vertex shader can resolve rects without any CPU work per instance.
+struct sprite_rect {
+    vec4 uv;     // x, y: top left -- z, w: size
+    vec2 size;   // world units
+    float layer; // atlas texture array layer
+    float pad;
+};
+
+enum { K_SPRITE_RECTS_PER_ROW = 128 };
+
+#define K_BAKED_ATLAS_PATH "assets/sprites.atlas"
+
+// Atlases are sliced into a grid of equally sized cells, each cell gets the next sprite id in
+// row-major order. The first atlas is the tile set so its ids match the level tile ids.
+typedef struct sprite_atlas_desc {
+    const char* path;
+    uint32_t cell_w;
+    uint32_t cell_h;
+} sprite_atlas_desc;
+
+// Packed offline by atlas_packer (see asset_pipeline.ps1) into K_BAKED_ATLAS_PATH, sliced at
+// startup when the baked atlas is missing.
+static const sprite_atlas_desc k_atlases[] = {
+    {.path = "assets/atlas2.png", .cell_w = 8, .cell_h = 8},
+    {.path = "assets/wizard_sheet.png", .cell_w = 8, .cell_h = 8},
 };
 
 typedef struct uniform_block {
     mat4 view_proj;
+    vec4 inst_dequant; // x: position scale, y: layer scale, z: anim tick length, w: fps scale
+    float time;        // spr_get_time() in anim ticks, wrapped
 } uniform_block;
 
+typedef struct sprite_batch {
+    sg_buffer inst_vbuf;
+    uint32_t count;
+    int16_t layer; // lowest layer of the batch's instances, batches are drawn as a single layer
+} sprite_batch;
+
+// contiguous range of the layer sorted instances that share the same layer
+struct layer_run {
+    int16_t layer;
+    uint32_t start;
+    uint32_t count;
+};
+
 // private system state
-#define K_MAX_SPRITES 16384
+enum {
+    // number of instance buffers rotated between frames so that streaming new instances never
+    // waits on the GPU still reading the previous frames' data
+    K_INST_STREAM_BUFFERS = 3,
+    K_INST_STREAM_MIN_CAPACITY = 16384,
+    // upper bound on flecs stages (worker threads) that can run RenderSpriteDrawCalls
+    K_MAX_SPRITE_STAGES = 64,
+};
+
+struct sprite* sprites = NULL; // stbds_arr, instances submitted with spr_draw since the last render
+
+// Instances written by RenderSpriteDrawCalls, one array per flecs stage so systems running on
+// worker threads never share an array. Merged with sprites when sorting by layer.
+struct sprite* staged_sprites[K_MAX_SPRITE_STAGES] = {0}; // stbds_arr per stage
 
-struct sprite sprites[K_MAX_SPRITES];
+// scratch state for bucketing instances by layer each frame
+struct sprite* sorted_sprites = NULL; // stbds_arr
+uint32_t* layer_offsets = NULL;       // stbds_arr
+struct layer_run* layer_runs = NULL;  // stbds_arr
+
+struct {
+    sg_buffer bufs[K_INST_STREAM_BUFFERS];
+    uint32_t capacity[K_INST_STREAM_BUFFERS]; // in instances
+    uint32_t used;                            // instances appended to the active buffer
+    uint32_t frame;
+} inst_stream;
+
+// Set by SystemSpriteRendererHeadless. Everything up to and including instance upload still runs
+// but instances land in inst_sink and no sokol calls are made, so no GL context is needed.
+bool headless = false;
+struct sprite* inst_sink = NULL; // stbds_arr
 
 sg_buffer geom_vbuf;
 sg_buffer geom_ibuf;
-sg_buffer inst_vbuf;
 sg_image atlas;
+sg_image rect_table;
+
+struct sprite_rect* sprite_rects = NULL; // stbds_arr, indexed by sprite id
+uint32_t atlas_first_ids[NUMBER_OF(k_atlases)];
 
-uint32_t sprite_ct;
 float pixels_per_meter = 16.0f;
 
+POOL_IMPL(sprite_batch)
+
+// batches queued with spr_draw_batch this frame
+sprite_batch* batch_queue = NULL; // stbds_arr
+
+struct {
+    vec2 pos;
+    float zoom;
+    vec2 view_min;
+    vec2 view_max;
+} camera;
+
+float render_time = 0.0f; // seconds, see spr_get_time
+
+enum { K_RENDER_STATS_HISTORY = 120 };
+
+spr_render_stats render_stats;
+float gpu_ms_history[K_RENDER_STATS_HISTORY]; // total of all passes, ring indexed by frame
+uint32_t render_stats_frame = 0;
+
+// Full canvas resolution, two canvas pixels per atlas texel. The view always covers the same world
+// area, dynamic resolution renders it into the top left 1/divisor of the canvas instead.
 const uint32_t k_canvas_width = 256 * 2;
 const uint32_t k_canvas_height = 144 * 2;
 
+enum {
+    // at 2 the canvas is down to one pixel per atlas texel, any lower and texels would be dropped
+    K_CANVAS_MAX_DIVISOR = 2,
+    // frames the GPU time has to stay over or under budget before the resolution changes
+    K_DYNAMIC_RES_HYSTERESIS_FRAMES = 30,
+};
+
 struct {
     sg_shader shader;
     sg_pipeline pip;
@@ -44,9 +183,20 @@ struct {
     sg_pass pass;
     sg_pass_action pass_action;
     sg_image color_img;
-    sg_image depth_img;
+    uint32_t divisor; // active resolution is k_canvas_width/height / divisor
 } canvas;
 
+struct {
+    bool enabled;
+    float budget_ms; // canvas and upscale pass GPU time
+    int frames_over;
+    int frames_under;
+} dynamic_res;
+
+typedef struct screen_uniform_block {
+    vec4 uv_rect; // x, y: offset -- z, w: scale of the canvas region to sample
+} screen_uniform_block;
+
 struct {
     sg_shader shader;
     sg_pipeline pip;
@@ -54,28 +204,295 @@ struct {
     sg_pass_action pass_action;
 } screen;
 
-void spr_init()
+static void atlas_upload(const stbi_uc* pixels, int layer_w, int layer_h, int layers)
 {
-    sg_setup(&(sg_desc){0});
-
-    // Configure render target render
-    int iw, ih, ichan;
-    stbi_uc* pixels = stbi_load("assets/atlas2.png", &iw, &ih, &ichan, 4);
-    TX_ASSERT(pixels);
+    if (headless) {
+        return;
+    }
 
     atlas = sg_make_image(&(sg_image_desc){
-        .width = iw,
-        .height = ih,
+        .type = SG_IMAGETYPE_ARRAY,
+        .width = layer_w,
+        .height = layer_h,
+        .layers = layers,
         .pixel_format = SG_PIXELFORMAT_RGBA8,
         .min_filter = SG_FILTER_NEAREST,
         .mag_filter = SG_FILTER_NEAREST,
         .content.subimage[0][0] =
             {
                 .ptr = pixels,
-                .size = iw * ih * ichan,
+                .size = layer_w * layer_h * 4 * layers,
+            },
+    });
+}
+
+// Loads the pages and rect table written by the atlas_packer tool. The sources must match
+// k_atlases so sprite ids line up with the grid sliced fallback, and must not have been saved since
+// the atlas was packed so edits show up without repacking.
+static bool atlas_load_baked(const char* path)
+{
+    int64_t atlas_mtime = 0;
+    if (get_file_mtime(path, &atlas_mtime) != TX_SUCCESS) {
+        return false;
+    }
+
+    // sources may be missing when only the baked atlas ships
+    for (uint32_t i = 0; i < NUMBER_OF(k_atlases); ++i) {
+        int64_t source_mtime = 0;
+        if (get_file_mtime(k_atlases[i].path, &source_mtime) == TX_SUCCESS
+            && source_mtime > atlas_mtime) {
+            printf(
+                "sprite atlas '%s' is older than '%s', slicing source atlases instead.\n",
+                path,
+                k_atlases[i].path);
+            return false;
+        }
+    }
+
+    uint8_t* data = NULL;
+    size_t len = 0;
+    if (read_binary_file_to_buffer(path, &data, &len) != TX_SUCCESS) {
+        return false;
+    }
+
+    bool loaded = false;
+    stbi_uc* pixels = NULL;
+
+    sprite_atlas_header header;
+    if (len < sizeof(header)) {
+        goto exit;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    size_t expected_len = sizeof(header) + sizeof(sprite_atlas_page) * header.page_count +
+                          sizeof(sprite_atlas_source) * header.source_count +
+                          sizeof(sprite_atlas_rect) * header.sprite_count;
+    if (header.magic != SPRITE_ATLAS_MAGIC || header.version != SPRITE_ATLAS_VERSION ||
+        header.source_count != NUMBER_OF(k_atlases) || header.page_count == 0 ||
+        expected_len > len) {
+        printf("sprite atlas '%s' is out of date, slicing source atlases instead.\n", path);
+        goto exit;
+    }
+
+    const sprite_atlas_page* pages = (const sprite_atlas_page*)(data + sizeof(header));
+    const sprite_atlas_source* sources =
+        (const sprite_atlas_source*)(pages + header.page_count);
+    const sprite_atlas_rect* rects = (const sprite_atlas_rect*)(sources + header.source_count);
+
+    for (uint32_t i = 0; i < header.source_count; ++i) {
+        const char* name = strrchr(k_atlases[i].path, '/');
+        name = name ? name + 1 : k_atlases[i].path;
+        if (strncmp(sources[i].path, name, SPRITE_ATLAS_PATH_LEN) != 0 ||
+            sources[i].cell_w != k_atlases[i].cell_w || sources[i].cell_h != k_atlases[i].cell_h) {
+            printf("sprite atlas '%s' is out of date, slicing source atlases instead.\n", path);
+            goto exit;
+        }
+        atlas_first_ids[i] = sources[i].first_id;
+    }
+
+    // pages sit next to the rect table
+    size_t dir_len = (size_t)(strrchr(path, '/') ? strrchr(path, '/') + 1 - path : 0);
+    size_t page_size = (size_t)header.page_width * header.page_height * 4;
+    pixels = malloc(page_size * header.page_count);
+    TX_ASSERT(pixels);
+
+    for (uint32_t i = 0; i < header.page_count; ++i) {
+        char page_path[256];
+        snprintf(
+            page_path,
+            sizeof(page_path),
+            "%.*s%.*s",
+            (int)dir_len,
+            path,
+            SPRITE_ATLAS_PATH_LEN,
+            pages[i].path);
+
+        int w, h, ichan;
+        stbi_uc* page = stbi_load(page_path, &w, &h, &ichan, 4);
+        if (!page || w != (int)header.page_width || h != (int)header.page_height) {
+            printf("failed to load sprite atlas page '%s'.\n", page_path);
+            stbi_image_free(page);
+            goto exit;
+        }
+
+        memcpy(pixels + page_size * i, page, page_size);
+        stbi_image_free(page);
+    }
+
+    for (uint32_t i = 0; i < header.sprite_count; ++i) {
+        const sprite_atlas_rect* rect = &rects[i];
+        arrput(
+            sprite_rects,
+            ((struct sprite_rect){
+                .uv =
+                    {
+                        .x = (float)rect->x / header.page_width,
+                        .y = (float)rect->y / header.page_height,
+                        .z = (float)rect->w / header.page_width,
+                        .w = (float)rect->h / header.page_height,
+                    },
+                .size =
+                    {
+                        .x = rect->w / K_TEXELS_PER_UNIT,
+                        .y = rect->h / K_TEXELS_PER_UNIT,
+                    },
+                .layer = (float)rect->page,
+            }));
+    }
+
+    atlas_upload(pixels, (int)header.page_width, (int)header.page_height, (int)header.page_count);
+    loaded = true;
+
+exit:
+    if (!loaded) {
+        arrsetlen(sprite_rects, 0);
+    }
+    free(pixels);
+    free(data);
+    return loaded;
+}
+
+// Fallback when no baked atlas exists: loads every source atlas into a layer of the texture array
+// and slices it into grid cells at startup.
+static void atlas_slice_sources(void)
+{
+    enum { ATLAS_COUNT = NUMBER_OF(k_atlases) };
+
+    stbi_uc* images[ATLAS_COUNT] = {0};
+    int widths[ATLAS_COUNT] = {0};
+    int heights[ATLAS_COUNT] = {0};
+    int layer_w = 0, layer_h = 0;
+
+    for (int i = 0; i < ATLAS_COUNT; ++i) {
+        int ichan;
+        images[i] = stbi_load(k_atlases[i].path, &widths[i], &heights[i], &ichan, 4);
+        if (!images[i]) {
+            printf("failed to load sprite atlas '%s'.\n", k_atlases[i].path);
+        }
+        // every later atlas's sprite ids would shift, there is nothing sensible to draw
+        TX_ASSERT_ALWAYS(images[i]);
+        layer_w = (widths[i] > layer_w) ? widths[i] : layer_w;
+        layer_h = (heights[i] > layer_h) ? heights[i] : layer_h;
+    }
+
+    // smaller atlases sit in the top left corner of their layer
+    size_t layer_size = (size_t)layer_w * layer_h * 4;
+    stbi_uc* pixels = calloc(ATLAS_COUNT, layer_size);
+    TX_ASSERT(pixels);
+
+    for (int i = 0; i < ATLAS_COUNT; ++i) {
+        for (int y = 0; y < heights[i]; ++y) {
+            memcpy(
+                pixels + layer_size * i + (size_t)y * layer_w * 4,
+                images[i] + (size_t)y * widths[i] * 4,
+                (size_t)widths[i] * 4);
+        }
+
+        const sprite_atlas_desc* desc = &k_atlases[i];
+        atlas_first_ids[i] = (uint32_t)arrlen(sprite_rects);
+        for (uint32_t cy = 0; cy + desc->cell_h <= (uint32_t)heights[i]; cy += desc->cell_h) {
+            for (uint32_t cx = 0; cx + desc->cell_w <= (uint32_t)widths[i]; cx += desc->cell_w) {
+                arrput(
+                    sprite_rects,
+                    ((struct sprite_rect){
+                        .uv =
+                            {
+                                .x = (float)cx / layer_w,
+                                .y = (float)cy / layer_h,
+                                .z = (float)desc->cell_w / layer_w,
+                                .w = (float)desc->cell_h / layer_h,
+                            },
+                        .size =
+                            {
+                                .x = desc->cell_w / K_TEXELS_PER_UNIT,
+                                .y = desc->cell_h / K_TEXELS_PER_UNIT,
+                            },
+                        .layer = (float)i,
+                    }));
+            }
+        }
+
+        stbi_image_free(images[i]);
+    }
+
+    atlas_upload(pixels, layer_w, layer_h, ATLAS_COUNT);
+    free(pixels);
+}
+
+// Uploads the sprite rect table, see struct sprite_rect.
+static void rect_table_upload(void)
+{
+    if (headless) {
+        return;
+    }
+
+    // pad the table out to whole rows
+    uint32_t rect_ct = (uint32_t)arrlen(sprite_rects);
+    uint32_t rows = (rect_ct + K_SPRITE_RECTS_PER_ROW - 1) / K_SPRITE_RECTS_PER_ROW;
+    rows = (rows > 0) ? rows : 1;
+    struct sprite_rect* table = calloc(rows * K_SPRITE_RECTS_PER_ROW, sizeof(struct sprite_rect));
+    TX_ASSERT(table);
+    memcpy(table, sprite_rects, sizeof(struct sprite_rect) * rect_ct);
+
+    rect_table = sg_make_image(&(sg_image_desc){
+        .width = K_SPRITE_RECTS_PER_ROW * 2,
+        .height = (int)rows,
+        .pixel_format = SG_PIXELFORMAT_RGBA32F,
+        .min_filter = SG_FILTER_NEAREST,
+        .mag_filter = SG_FILTER_NEAREST,
+        .content.subimage[0][0] =
+            {
+                .ptr = table,
+                .size = (int)(sizeof(struct sprite_rect) * rows * K_SPRITE_RECTS_PER_ROW),
             },
     });
 
+    free(table);
+}
+
+// All atlases live in layers of a single texture array and the sprite rect table is baked up front
+// so every sprite can be drawn with the same bindings.
+static void atlas_init(void)
+{
+    arrsetlen(sprite_rects, 0);
+    if (!atlas_load_baked(K_BAKED_ATLAS_PATH)) {
+        atlas_slice_sources();
+    }
+    rect_table_upload();
+}
+
+void spr_init()
+{
+    // instance layout read by sprite.vert
+    TX_ASSERT(sizeof(struct sprite) == 16);
+
+    if (!headless) {
+        sg_setup(&(sg_desc){0});
+    }
+
+    sprite_batch_pool_set_capacity(1024);
+
+    canvas.divisor = 1;
+
+    // frame the canvas so its top left corner starts at (1, 1) until a camera is provided
+    spr_set_camera(
+        (vec2){
+            .x = 1.0f + k_canvas_width / pixels_per_meter * 0.5f,
+            .y = 1.0f + k_canvas_height / pixels_per_meter * 0.5f,
+        },
+        1.0f);
+
+    atlas_init();
+
+    arrsetcap(sprites, K_INST_STREAM_MIN_CAPACITY);
+
+    if (headless) {
+        arrsetcap(inst_sink, K_INST_STREAM_MIN_CAPACITY);
+        return;
+    }
+
+    gpu_timer_init();
+
     const float k_size = 1.0f;
     struct vertex quad_verts[] = {
         {.pos = {.x = 0, .y = 0}, .uv = {.x = 0.0f, .y = 0.0f}},
@@ -97,22 +514,21 @@ void spr_init()
         .size = sizeof(quad_indices),
     });
 
-    inst_vbuf = sg_make_buffer(&(sg_buffer_desc){
-        .usage = SG_USAGE_STREAM,
-        .size = sizeof(sprites),
-    });
+    for (int i = 0; i < K_INST_STREAM_BUFFERS; ++i) {
+        inst_stream.capacity[i] = K_INST_STREAM_MIN_CAPACITY;
+        inst_stream.bufs[i] = sg_make_buffer(&(sg_buffer_desc){
+            .usage = SG_USAGE_STREAM,
+            .size = sizeof(struct sprite) * K_INST_STREAM_MIN_CAPACITY,
+        });
+    }
 
-    {
-        char* vs_buffer;
-        char* fs_buffer;
-        size_t vs_len, fs_len;
+    shader_bundle_init();
 
-        enum tx_result vs_result =
-            read_file_to_buffer("assets/shaders/sprite.vert", &vs_buffer, &vs_len);
-        enum tx_result fs_result =
-            read_file_to_buffer("assets/shaders/sprite.frag", &fs_buffer, &fs_len);
+    {
+        char* vs_buffer = shader_source_load("sprite.vert");
+        char* fs_buffer = shader_source_load("sprite.frag");
 
-        TX_ASSERT(vs_result == TX_SUCCESS && fs_result == TX_SUCCESS);
+        TX_ASSERT(vs_buffer && fs_buffer);
 
         canvas.shader = sg_make_shader(&(sg_shader_desc){
             .vs.uniform_blocks[0] =
@@ -121,15 +537,18 @@ void spr_init()
                     .uniforms =
                         {
                             [0] = {.name = "view_proj", .type = SG_UNIFORMTYPE_MAT4},
+                            [1] = {.name = "inst_dequant", .type = SG_UNIFORMTYPE_FLOAT4},
+                            [2] = {.name = "time", .type = SG_UNIFORMTYPE_FLOAT},
                         },
                 },
-            .fs.images[0] = {.name = "atlas", .type = SG_IMAGETYPE_2D},
+            .vs.images[0] = {.name = "sprite_rects", .type = SG_IMAGETYPE_2D},
+            .fs.images[0] = {.name = "atlas", .type = SG_IMAGETYPE_ARRAY},
             .vs.source = vs_buffer,
             .fs.source = fs_buffer,
         });
 
-        free(vs_buffer);
-        free(fs_buffer);
+        shader_source_free(vs_buffer);
+        shader_source_free(fs_buffer);
     }
 
     sg_image_desc image_desc = (sg_image_desc){
@@ -141,15 +560,12 @@ void spr_init()
     };
 
     canvas.color_img = sg_make_image(&image_desc);
-    image_desc.pixel_format = SG_PIXELFORMAT_DEPTH;
-    canvas.depth_img = sg_make_image(&image_desc);
 
+    // sprites are drawn back to front in layer order so the canvas needs no depth buffer
     canvas.pass = sg_make_pass(&(sg_pass_desc){
         .color_attachments[0].image = canvas.color_img,
-        .depth_stencil_attachment.image = canvas.depth_img,
     });
 
-    // default render states are fine for triangle
     canvas.pip = sg_make_pipeline(&(sg_pipeline_desc){
         .shader = canvas.shader,
         .index_type = SG_INDEXTYPE_UINT16,
@@ -180,33 +596,28 @@ void spr_init()
                             },
                         [2] =
                             {
-                                .format = SG_VERTEXFORMAT_FLOAT3,
+                                .format = SG_VERTEXFORMAT_SHORT4,
                                 .offset = 0,
                                 .buffer_index = 1,
                             },
                         [3] =
                             {
-                                .format = SG_VERTEXFORMAT_FLOAT4,
-                                .offset = 12,
+                                .format = SG_VERTEXFORMAT_UBYTE4,
+                                .offset = 8,
                                 .buffer_index = 1,
                             },
                         [4] =
                             {
-                                .format = SG_VERTEXFORMAT_FLOAT2,
-                                .offset = 28,
+                                .format = SG_VERTEXFORMAT_USHORT2N,
+                                .offset = 12,
                                 .buffer_index = 1,
                             },
                     },
             },
-        .depth_stencil =
-            {
-                .depth_compare_func = SG_COMPAREFUNC_LESS_EQUAL,
-                .depth_write_enabled = true,
-            },
         .blend =
             {
                 .enabled = true,
-                .depth_format = SG_PIXELFORMAT_DEPTH,
+                .depth_format = SG_PIXELFORMAT_NONE,
                 .src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA,
                 .dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
                 .src_factor_alpha = SG_BLENDFACTOR_ONE,
@@ -219,33 +630,32 @@ void spr_init()
         .vertex_buffers =
             {
                 [0] = geom_vbuf,
-                [1] = inst_vbuf,
             },
         .index_buffer = geom_ibuf,
+        .vs_images[0] = rect_table,
         .fs_images[0] = atlas,
     };
 
     // Configure screen full-screen quad render
     {
-        char* vs_buffer;
-        char* fs_buffer;
-        size_t vs_len, fs_len;
-
-        enum tx_result vs_result =
-            read_file_to_buffer("assets/shaders/fullscreen_quad.vert", &vs_buffer, &vs_len);
-        enum tx_result fs_result =
-            read_file_to_buffer("assets/shaders/fullscreen_quad.frag", &fs_buffer, &fs_len);
+        char* vs_buffer = shader_source_load("fullscreen_quad.vert");
+        char* fs_buffer = shader_source_load("fullscreen_quad.frag");
 
-        TX_ASSERT(vs_result == TX_SUCCESS && fs_result == TX_SUCCESS);
+        TX_ASSERT(vs_buffer && fs_buffer);
 
         screen.shader = sg_make_shader(&(sg_shader_desc){
+            .vs.uniform_blocks[0] =
+                {
+                    .size = sizeof(screen_uniform_block),
+                    .uniforms[0] = {.name = "uv_rect", .type = SG_UNIFORMTYPE_FLOAT4},
+                },
             .fs.images[0] = {.name = "screen_texture", .type = SG_IMAGETYPE_2D},
             .vs.source = vs_buffer,
             .fs.source = fs_buffer,
         });
 
-        free(vs_buffer);
-        free(fs_buffer);
+        shader_source_free(vs_buffer);
+        shader_source_free(fs_buffer);
     }
 
     // Our fullscreen quad shader doesn't require any attributes but sokol has no mechanism for
@@ -279,122 +689,676 @@ void spr_init()
     screen.pass_action = (sg_pass_action){
         .colors[0] = {.action = SG_ACTION_CLEAR, .val = {0.1f, 0.0f, 0.1f}},
     };
+
+    shader_bundle_term();
 }
 
 void spr_term(ecs_world_t* world, void* ctx)
 {
-    sg_shutdown();
+    for (int i = 0; i < arrlen(sprite_batch_pool.handles); ++i) {
+        if (VALID_HANDLE(sprite_batch_pool.handles[i])) {
+            spr_batch_destroy(sprite_batch_pool.handles[i]);
+        }
+    }
+    sprite_batch_pool_free();
+    arrfree(batch_queue);
+    arrfree(sprites);
+    for (uint32_t i = 0; i < K_MAX_SPRITE_STAGES; ++i) {
+        arrfree(staged_sprites[i]);
+    }
+    arrfree(sorted_sprites);
+    arrfree(layer_offsets);
+    arrfree(layer_runs);
+    arrfree(sprite_rects);
+    arrfree(inst_sink);
+
+    if (!headless) {
+        gpu_timer_term();
+        sg_shutdown();
+    }
 }
 
-void spr_render()
+// Makes room for count instances in the current frame's instance buffer. Must be called before the
+// frame's first inst_stream_append, growing replaces the buffer so it can't happen once instances
+// have been appended to it.
+static void inst_stream_reserve(uint32_t count)
 {
-    // int width, height;
-    // window_get_size(&width, &height);
-    // TODO: for real
-    int width = 1280, height = 720;
+    if (headless) {
+        return;
+    }
+
+    uint32_t index = inst_stream.frame % K_INST_STREAM_BUFFERS;
+    TX_ASSERT(inst_stream.used == 0);
+    if (count <= inst_stream.capacity[index]) {
+        return;
+    }
+
+    uint32_t capacity = inst_stream.capacity[index];
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    // draws recorded in earlier frames keep the old buffer alive in the driver until the GPU is
+    // done with it so it can be destroyed immediately.
+    sg_destroy_buffer(inst_stream.bufs[index]);
+    inst_stream.bufs[index] = sg_make_buffer(&(sg_buffer_desc){
+        .usage = SG_USAGE_STREAM,
+        .size = sizeof(struct sprite) * capacity,
+    });
+    inst_stream.capacity[index] = capacity;
+}
 
-    sg_update_buffer(inst_vbuf, sprites, sizeof(struct sprite) * sprite_ct);
+// Copies instances into the instance buffer for the current frame and returns the buffer and byte
+// offset to bind them from. May be called any number of times per frame as long as the instances
+// of all calls were reserved with inst_stream_reserve beforehand.
+static int inst_stream_append(const struct sprite* data, uint32_t count, sg_buffer* out_buf)
+{
+    if (headless) {
+        size_t offset = arrlenu(inst_sink);
+        arrsetlen(inst_sink, offset + count);
+        memcpy(inst_sink + offset, data, sizeof(struct sprite) * count);
+        *out_buf = (sg_buffer){SG_INVALID_ID};
+        return (int)(offset * sizeof(struct sprite));
+    }
+
+    uint32_t index = inst_stream.frame % K_INST_STREAM_BUFFERS;
+    TX_ASSERT(inst_stream.used + count <= inst_stream.capacity[index]);
+
+    *out_buf = inst_stream.bufs[index];
+    inst_stream.used += count;
+    return sg_append_buffer(*out_buf, data, sizeof(struct sprite) * count);
+}
+
+static void inst_stream_next_frame(void)
+{
+    inst_stream.frame++;
+    inst_stream.used = 0;
+    arrsetlen(inst_sink, 0);
+}
+
+// Collects the non-empty instance arrays submitted this frame, spr_draw's first then each stage's.
+static uint32_t gather_sprite_sources(struct sprite** out_sources)
+{
+    uint32_t source_ct = 0;
+    if (arrlen(sprites) > 0) {
+        out_sources[source_ct++] = sprites;
+    }
+    for (uint32_t i = 0; i < K_MAX_SPRITE_STAGES; ++i) {
+        if (arrlen(staged_sprites[i]) > 0) {
+            out_sources[source_ct++] = staged_sprites[i];
+        }
+    }
+    return source_ct;
+}
+
+// Stable counting sort of this frame's instances from every source into sorted_sprites by their
+// fixed point layer, recording one layer_run per non-empty layer in back to front order.
+static void sort_sprites_by_layer(void)
+{
+    struct sprite* sources[K_MAX_SPRITE_STAGES + 1];
+    uint32_t source_ct = gather_sprite_sources(sources);
+
+    uint32_t sprite_ct = 0;
+    int16_t min_layer = INT16_MAX, max_layer = INT16_MIN;
+    for (uint32_t s = 0; s < source_ct; ++s) {
+        const struct sprite* src = sources[s];
+        uint32_t src_ct = (uint32_t)arrlen(src);
+        for (uint32_t i = 0; i < src_ct; ++i) {
+            min_layer = (src[i].layer < min_layer) ? src[i].layer : min_layer;
+            max_layer = (src[i].layer > max_layer) ? src[i].layer : max_layer;
+        }
+        sprite_ct += src_ct;
+    }
+
+    arrsetlen(layer_runs, 0);
+    arrsetlen(sorted_sprites, sprite_ct);
+
+    if (sprite_ct == 0) {
+        return;
+    }
+
+    uint32_t bucket_ct = (uint32_t)(max_layer - min_layer) + 1;
+    arrsetlen(layer_offsets, bucket_ct);
+    memset(layer_offsets, 0, sizeof(uint32_t) * bucket_ct);
+
+    for (uint32_t s = 0; s < source_ct; ++s) {
+        const struct sprite* src = sources[s];
+        for (uint32_t i = 0; i < (uint32_t)arrlen(src); ++i) {
+            layer_offsets[src[i].layer - min_layer]++;
+        }
+    }
+
+    uint32_t start = 0;
+    for (uint32_t b = 0; b < bucket_ct; ++b) {
+        uint32_t count = layer_offsets[b];
+        if (count > 0) {
+            arrput(
+                layer_runs,
+                ((struct layer_run){
+                    .layer = (int16_t)(min_layer + b),
+                    .start = start,
+                    .count = count,
+                }));
+        }
+        layer_offsets[b] = start;
+        start += count;
+    }
+
+    for (uint32_t s = 0; s < source_ct; ++s) {
+        const struct sprite* src = sources[s];
+        for (uint32_t i = 0; i < (uint32_t)arrlen(src); ++i) {
+            sorted_sprites[layer_offsets[src[i].layer - min_layer]++] = src[i];
+        }
+    }
+}
+
+// insertion sort, there are only ever a handful of batches and submission order is kept per layer
+static void sort_batch_queue(void)
+{
+    for (int i = 1; i < arrlen(batch_queue); ++i) {
+        sprite_batch batch = batch_queue[i];
+        int j = i - 1;
+        while (j >= 0 && batch_queue[j].layer > batch.layer) {
+            batch_queue[j + 1] = batch_queue[j];
+            --j;
+        }
+        batch_queue[j + 1] = batch;
+    }
+}
+
+// Largest integer multiple of the full canvas that fits the drawable, centered. Drawables smaller
+// than the canvas get an aspect correct fit instead since nothing integer would fit.
+static void screen_rect(int width, int height, int* out_x, int* out_y, int* out_w, int* out_h)
+{
+    int scale_x = width / (int)k_canvas_width;
+    int scale_y = height / (int)k_canvas_height;
+    int scale = (scale_x < scale_y) ? scale_x : scale_y;
+
+    if (scale >= 1) {
+        *out_w = (int)k_canvas_width * scale;
+        *out_h = (int)k_canvas_height * scale;
+    } else {
+        float fit = fminf((float)width / k_canvas_width, (float)height / k_canvas_height);
+        *out_w = (int)(k_canvas_width * fit);
+        *out_h = (int)(k_canvas_height * fit);
+    }
+
+    *out_x = (width - *out_w) / 2;
+    *out_y = (height - *out_h) / 2;
+}
+
+// Halves the canvas resolution once the GPU has been over budget for a while and restores it once
+// there is enough headroom to absorb four times the canvas fill cost.
+static void update_dynamic_resolution(float gpu_ms)
+{
+    if (!dynamic_res.enabled || gpu_ms <= 0.0f) {
+        canvas.divisor = dynamic_res.enabled ? canvas.divisor : 1;
+        return;
+    }
+
+    dynamic_res.frames_over = (gpu_ms > dynamic_res.budget_ms) ? dynamic_res.frames_over + 1 : 0;
+    dynamic_res.frames_under =
+        (gpu_ms < dynamic_res.budget_ms * 0.25f) ? dynamic_res.frames_under + 1 : 0;
+
+    if (dynamic_res.frames_over > K_DYNAMIC_RES_HYSTERESIS_FRAMES &&
+        canvas.divisor < K_CANVAS_MAX_DIVISOR) {
+        canvas.divisor *= 2;
+        dynamic_res.frames_over = 0;
+    } else if (dynamic_res.frames_under > K_DYNAMIC_RES_HYSTERESIS_FRAMES && canvas.divisor > 1) {
+        canvas.divisor /= 2;
+        dynamic_res.frames_under = 0;
+    }
+}
+
+// Draws the frame to the canvas and presents it to a drawable of width x height pixels, which is
+// skipped while either is 0, e.g. when the window is minimized.
+void spr_render(int width, int height)
+{
+    render_stats = (spr_render_stats){0};
 
     {
-        const float aspect = (float)k_canvas_width / k_canvas_height;
-        float view_width = k_canvas_width / pixels_per_meter;
-        float view_height = k_canvas_height / pixels_per_meter;
+        float view_width = camera.view_max.x - camera.view_min.x;
+        float view_height = camera.view_max.y - camera.view_min.y;
+
+        // snap the view to the canvas pixel grid so sprites land on whole pixels
+        int canvas_w = (int)k_canvas_width / (int)canvas.divisor;
+        int canvas_h = (int)k_canvas_height / (int)canvas.divisor;
+        float px_per_unit = canvas_w / view_width;
+        vec2 view_min = {
+            .x = floorf(camera.view_min.x * px_per_unit + 0.5f) / px_per_unit,
+            .y = floorf(camera.view_min.y * px_per_unit + 0.5f) / px_per_unit,
+        };
 
-        mat4 view = mat4_look_at((vec3){1, 1, 100}, (vec3){1, 1, -1}, (vec3){0, 1, 0});
+        mat4 view = mat4_look_at(
+            (vec3){view_min.x, view_min.y, 100},
+            (vec3){view_min.x, view_min.y, -1},
+            (vec3){0, 1, 0});
         mat4 projection = mat4_ortho(0, view_width, view_height, 0, 0.0f, 250.0f);
         mat4 view_proj = mat4_mul(projection, view);
 
-        sg_begin_pass(
-            canvas.pass,
-            &(sg_pass_action){
-                .colors[0] =
+        if (!headless) {
+            gpu_timer_begin(SPR_GPU_PASS_CANVAS);
+            sg_begin_pass(
+                canvas.pass,
+                &(sg_pass_action){
+                    .colors[0] =
+                        {
+                            .action = SG_ACTION_CLEAR,
+                            .val = {0.0f, 0.0f, 0.0f, 1.0f},
+                        },
+                });
+
+            // bottom left in GL texture space so the screen pass samples from uv (0, 0)
+            sg_apply_viewport(0, 0, canvas_w, canvas_h, false);
+            sg_apply_pipeline(canvas.pip);
+            uniform_block uniforms = {
+                .view_proj = view_proj,
+                .inst_dequant =
                     {
-                        .action = SG_ACTION_CLEAR,
-                        .val = {0.0f, 0.0f, 0.0f, 1.0f},
+                        1.0f / K_SPRITE_POS_SCALE,
+                        1.0f / K_SPRITE_LAYER_SCALE,
+                        1.0f / K_SPRITE_ANIM_TICKS,
+                        1.0f / K_SPRITE_ANIM_FPS_SCALE,
                     },
-            });
+                .time = fmodf(render_time * K_SPRITE_ANIM_TICKS, K_SPRITE_ANIM_TICK_WRAP),
+            };
+            sg_apply_uniforms(SG_SHADERSTAGE_VS, 0, &uniforms, sizeof(uniform_block));
+        }
+
+        sort_sprites_by_layer();
+        sort_batch_queue();
+
+        sg_buffer inst_buf = {SG_INVALID_ID};
+        int inst_offset = 0;
+        uint32_t sprite_ct = (uint32_t)arrlen(sorted_sprites);
+        inst_stream_reserve(sprite_ct);
+        if (sprite_ct > 0) {
+            inst_offset = inst_stream_append(sorted_sprites, sprite_ct, &inst_buf);
+        }
+        render_stats.bytes_uploaded = sprite_ct * (uint32_t)sizeof(struct sprite);
+
+        // Walk the layers back to front, each layer costs one bindings change and one draw.
+        // Batches are drawn before streamed instances on the same layer.
+        int run_ct = (int)arrlen(layer_runs);
+        int batch_ct = (int)arrlen(batch_queue);
+        int ri = 0, bi = 0;
+        while (ri < run_ct || bi < batch_ct) {
+            sg_bindings bindings = canvas.bindings;
+            uint32_t count;
+
+            if (bi < batch_ct && (ri >= run_ct || batch_queue[bi].layer <= layer_runs[ri].layer)) {
+                bindings.vertex_buffers[1] = batch_queue[bi].inst_vbuf;
+                count = batch_queue[bi].count;
+                render_stats.batches++;
+                ++bi;
+            } else {
+                bindings.vertex_buffers[1] = inst_buf;
+                bindings.vertex_buffer_offsets[1] =
+                    inst_offset + (int)(layer_runs[ri].start * sizeof(struct sprite));
+                count = layer_runs[ri].count;
+                ++ri;
+            }
+
+            render_stats.instances += count;
+            render_stats.draw_calls++;
+
+            if (!headless) {
+                sg_apply_bindings(&bindings);
+                sg_draw(0, 6, count);
+            }
+        }
+
+        if (!headless) {
+            sg_end_pass();
+            gpu_timer_end(SPR_GPU_PASS_CANVAS);
+
+            if (width > 0 && height > 0) {
+                int x, y, w, h;
+                screen_rect(width, height, &x, &y, &w, &h);
+
+                screen_uniform_block screen_uniforms = {
+                    .uv_rect = {0.0f, 0.0f, 1.0f / canvas.divisor, 1.0f / canvas.divisor},
+                };
+
+                gpu_timer_begin(SPR_GPU_PASS_UPSCALE);
+                sg_begin_default_pass(&screen.pass_action, width, height);
+                sg_apply_viewport(x, y, w, h, true);
+                sg_apply_pipeline(screen.pip);
+                sg_apply_bindings(&screen.bindings);
+                sg_apply_uniforms(
+                    SG_SHADERSTAGE_VS, 0, &screen_uniforms, sizeof(screen_uniform_block));
+                sg_draw(0, 6, 1);
+                sg_end_pass();
+                gpu_timer_end(SPR_GPU_PASS_UPSCALE);
+                render_stats.draw_calls++;
+            }
+
+            sg_commit();
+        }
+        inst_stream_next_frame();
+    }
 
-        sg_apply_pipeline(canvas.pip);
-        sg_apply_bindings(&canvas.bindings);
-        uniform_block uniforms = {.view_proj = view_proj};
-        sg_apply_uniforms(SG_SHADERSTAGE_VS, 0, &uniforms, sizeof(uniform_block));
-        sg_draw(0, 6, sprite_ct);
-        sg_end_pass();
+    float gpu_ms = 0.0f;
+    for (int i = 0; i < SPR_GPU_PASS_COUNT; ++i) {
+        render_stats.gpu_ms[i] = gpu_timer_get_ms(i);
+        gpu_ms += render_stats.gpu_ms[i];
+    }
+    gpu_ms_history[render_stats_frame++ % K_RENDER_STATS_HISTORY] = gpu_ms;
+    gpu_timer_next_frame();
 
-        sg_begin_default_pass(&screen.pass_action, width, height);
-        sg_apply_pipeline(screen.pip);
-        sg_apply_bindings(&screen.bindings);
-        sg_draw(0, 6, 1);
-        sg_end_pass();
+    update_dynamic_resolution(
+        render_stats.gpu_ms[SPR_GPU_PASS_CANVAS] + render_stats.gpu_ms[SPR_GPU_PASS_UPSCALE]);
 
-        sg_commit();
+    arrsetlen(sprites, 0);
+    for (uint32_t i = 0; i < K_MAX_SPRITE_STAGES; ++i) {
+        arrsetlen(staged_sprites[i], 0);
     }
+    arrsetlen(batch_queue, 0);
+}
+
+static int16_t quantize_i16(float v, float scale)
+{
+    return (int16_t)clampf(floorf(v * scale + 0.5f), (float)INT16_MIN, (float)INT16_MAX);
+}
 
-    sprite_ct = 0;
+static uint8_t quantize_unorm8(float v)
+{
+    return (uint8_t)(clampf(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// ticks wrap around so only the low 16 bits are kept
+static uint16_t quantize_anim_ticks(float seconds)
+{
+    return (uint16_t)(int64_t)floorf(seconds * K_SPRITE_ANIM_TICKS + 0.5f);
+}
+
+static struct sprite sprite_from_desc(const sprite_draw_desc* desc)
+{
+    TX_ASSERT(desc->sprite_id <= INT16_MAX);
+    TX_ASSERT(desc->anim.frame_count <= SPRITE_ANIM_MAX_FRAMES);
+    TX_ASSERT(desc->sprite_id + desc->anim.frame_count <= INT16_MAX + 1u);
+    TX_ASSERT(desc->anim.fps < 256.0f);
+
+    // a clip without frames or speed is just its first frame
+    uint32_t sprite_id = desc->sprite_id;
+    bool animated = desc->anim.frame_count > 1 && desc->anim.fps > 0.0f;
+
+    // a clip played once holds its last frame forever, which the wrapping tick clock can't tell
+    if (animated && desc->anim.mode == SPRITE_ANIM_ONCE
+        && (render_time - desc->anim.start_time) * desc->anim.fps >= desc->anim.frame_count) {
+        sprite_id += desc->anim.frame_count - 1;
+        animated = false;
+    }
+
+    return (struct sprite){
+        .pos_x = quantize_i16(desc->pos.x, K_SPRITE_POS_SCALE),
+        .pos_y = quantize_i16(desc->pos.y, K_SPRITE_POS_SCALE),
+        .layer = quantize_i16(desc->layer, K_SPRITE_LAYER_SCALE),
+        .sprite_id = (int16_t)sprite_id,
+        .flags = (uint8_t)(desc->flip | (desc->anim.mode << K_SPRITE_ANIM_MODE_SHIFT)),
+        .origin_x = quantize_unorm8(desc->origin.x),
+        .origin_y = quantize_unorm8(desc->origin.y),
+        .frame_count = animated ? (uint8_t)desc->anim.frame_count : 1,
+        .anim_start = animated ? quantize_anim_ticks(desc->anim.start_time) : 0,
+        .anim_fps = animated ? (uint16_t)(desc->anim.fps * K_SPRITE_ANIM_FPS_SCALE + 0.5f) : 0,
+    };
+}
+
+// sprite quads are sized by their rect and offset by their origin, unknown sprites are never visible
+static bool spr_in_view(uint32_t sprite_id, vec2 pos, vec2 origin)
+{
+    if (!VALID_INDEX(sprite_id, arrlen(sprite_rects))) {
+        return false;
+    }
+
+    vec2 size = sprite_rects[sprite_id].size;
+    float x = pos.x - clampf(origin.x, 0.0f, 1.0f) * size.x;
+    float y = pos.y - clampf(origin.y, 0.0f, 1.0f) * size.y;
+    return x + size.x > camera.view_min.x && x < camera.view_max.x
+           && y + size.y > camera.view_min.y && y < camera.view_max.y;
 }
 
 void spr_draw(const sprite_draw_desc* desc)
 {
     TX_ASSERT(desc);
-    TX_ASSERT(sprite_ct < K_MAX_SPRITES);
 
-    uint32_t row = desc->sprite_id / 16;
-    uint32_t col = desc->sprite_id % 16;
+    if (!spr_in_view(desc->sprite_id, desc->pos, desc->origin)) {
+        return;
+    }
 
-    const float flip_offsets[3] = {0.0f, 1.0f, 1.0f};
-    const float flip_scales[3] = {1.0f, -1.0f, -1.0f};
+    arrput(sprites, sprite_from_desc(desc));
+}
 
-    float fx = flip_offsets[desc->flip & SPRITE_FLIP_X];
-    float fy = flip_offsets[desc->flip & SPRITE_FLIP_Y];
+sprite_batch_handle spr_batch_create(const sprite_draw_desc* descs, uint32_t count)
+{
+    if (!descs || count == 0) {
+        return INVALID_HANDLE(sprite_batch);
+    }
 
-    float fw = flip_scales[desc->flip & SPRITE_FLIP_X];
-    float fh = flip_scales[desc->flip & SPRITE_FLIP_Y];
+    sprite_batch_handle handle = sprite_batch_acquire();
+    if (!VALID_HANDLE(handle)) {
+        return handle;
+    }
 
-    sprites[sprite_ct] = (struct sprite){
-        .pos =
-            (vec3){
-                .x = desc->pos.x,
-                .y = desc->pos.y,
-                .z = desc->layer,
-            },
-        .rect = {(col + fx) / 16.0f, (row + fy) / 16.0f, fw / 16, fh / 16},
-        .origin = desc->origin,
+    struct sprite* batch_sprites = NULL;
+    arrsetlen(batch_sprites, count);
+    for (uint32_t i = 0; i < count; ++i) {
+        batch_sprites[i] = sprite_from_desc(&descs[i]);
+    }
+
+    int16_t layer = INT16_MAX;
+    for (uint32_t i = 0; i < count; ++i) {
+        layer = (batch_sprites[i].layer < layer) ? batch_sprites[i].layer : layer;
+    }
+
+    sg_buffer inst_vbuf = {SG_INVALID_ID};
+    if (!headless) {
+        inst_vbuf = sg_make_buffer(&(sg_buffer_desc){
+            .usage = SG_USAGE_IMMUTABLE,
+            .size = sizeof(struct sprite) * count,
+            .content = batch_sprites,
+        });
+    }
+
+    uint32_t index = sprite_batch_handle_get_index(handle);
+    sprite_batch_pool.data[index] = (sprite_batch){
+        .inst_vbuf = inst_vbuf,
+        .count = count,
+        .layer = layer,
     };
-    sprite_ct++;
+
+    arrfree(batch_sprites);
+
+    return handle;
 }
 
-void RenderSpriteDrawCalls(ecs_iter_t* it)
+void spr_batch_destroy(sprite_batch_handle handle)
 {
-    Position* position = ecs_column(it, Position, 1);
-    SpriteDraw* sprite = ecs_column(it, SpriteDraw, 2);
+    sprite_batch* batch = sprite_batch_ptr(handle);
+    if (batch) {
+        if (!headless) {
+            sg_destroy_buffer(batch->inst_vbuf);
+        }
+        *batch = (sprite_batch){0};
+        sprite_batch_release(handle);
+    }
+}
+
+uint32_t spr_batch_get_bytes(sprite_batch_handle handle)
+{
+    sprite_batch* batch = sprite_batch_ptr(handle);
+    return batch ? batch->count * (uint32_t)sizeof(struct sprite) : 0;
+}
+
+void spr_draw_batch(sprite_batch_handle handle)
+{
+    sprite_batch* batch = sprite_batch_ptr(handle);
+    if (batch) {
+        arrput(batch_queue, *batch);
+    }
+}
+
+void spr_set_camera(vec2 pos, float zoom)
+{
+    zoom = (zoom > 0.0f) ? zoom : 1.0f;
+
+    vec2 half_extents = {
+        .x = k_canvas_width / pixels_per_meter / zoom * 0.5f,
+        .y = k_canvas_height / pixels_per_meter / zoom * 0.5f,
+    };
+
+    camera.pos = pos;
+    camera.zoom = zoom;
+    camera.view_min = vec2_sub(pos, half_extents);
+    camera.view_max = vec2_add(pos, half_extents);
+}
+
+uint32_t spr_get_atlas_sprite_id(uint32_t atlas_index, uint32_t cell_index)
+{
+    TX_ASSERT(VALID_INDEX(atlas_index, NUMBER_OF(k_atlases)));
+    return atlas_first_ids[atlas_index] + cell_index;
+}
+
+vec2 spr_get_camera_pos(void)
+{
+    return camera.pos;
+}
+
+void spr_get_view_bounds(vec2* min, vec2* max)
+{
+    TX_ASSERT(min && max);
+
+    *min = camera.view_min;
+    *max = camera.view_max;
+}
+
+float spr_get_time(void)
+{
+    return render_time;
+}
+
+void spr_set_dynamic_resolution(bool enabled, float budget_ms)
+{
+    dynamic_res.enabled = enabled;
+    dynamic_res.budget_ms = budget_ms;
+    dynamic_res.frames_over = 0;
+    dynamic_res.frames_under = 0;
+}
+
+uint32_t spr_get_canvas_divisor(void)
+{
+    return canvas.divisor;
+}
+
+spr_render_stats spr_get_render_stats(void)
+{
+    return render_stats;
+}
+
+void spr_gpu_pass_begin(spr_gpu_pass pass)
+{
+    gpu_timer_begin(pass);
+}
+
+void spr_gpu_pass_end(spr_gpu_pass pass)
+{
+    gpu_timer_end(pass);
+}
+
+void spr_render_stats_window(bool* show)
+{
+    static const char* k_pass_names[SPR_GPU_PASS_COUNT] = {"canvas", "upscale", "imgui"};
+
+    if (igBegin("Render Stats", show, ImGuiWindowFlags_None)) {
+        igText("instances: %u", render_stats.instances);
+        igText("batches: %u", render_stats.batches);
+        igText("draw calls: %u", render_stats.draw_calls);
+        igText("uploaded: %.1f KiB", render_stats.bytes_uploaded / 1024.0f);
+        igText(
+            "canvas: %ux%u",
+            k_canvas_width / canvas.divisor,
+            k_canvas_height / canvas.divisor);
+
+        igSeparator();
+
+        for (int i = 0; i < SPR_GPU_PASS_COUNT; ++i) {
+            igText("%-8s %6.3f ms", k_pass_names[i], render_stats.gpu_ms[i]);
+        }
+
+        igPlotLinesFloatPtr(
+            "gpu ms",
+            gpu_ms_history,
+            K_RENDER_STATS_HISTORY,
+            (int)(render_stats_frame % K_RENDER_STATS_HISTORY),
+            NULL,
+            0.0f,
+            FLT_MAX,
+            (ImVec2){0, 60.0f},
+            sizeof(float));
+    }
+    igEnd();
+}
+
+void UpdateSpriteCamera(ecs_iter_t* it)
+{
+    SpriteCamera* sprite_camera = ecs_column(it, SpriteCamera, 1);
+    ecs_entity_t ecs_typeid(Position) = ecs_column_entity(it, 2);
 
     for (int i = 0; i < it->count; ++i) {
-        uint32_t row = sprite[i].sprite_id / 16;
-        uint32_t col = sprite[i].sprite_id % 16;
+        ecs_entity_t follow = sprite_camera[i].follow;
+        if (follow && ecs_is_alive(it->world, follow)) {
+            const Position* target = ecs_get(it->world, follow, Position);
+            if (target) {
+                sprite_camera[i].pos = *target;
+            }
+        }
+
+        spr_set_camera(sprite_camera[i].pos, sprite_camera[i].zoom);
+    }
+}
 
-        const float flip_offsets[3] = {0.0f, 1.0f, 1.0f};
-        const float flip_scales[3] = {1.0f, -1.0f, -1.0f};
+void RenderSpriteDrawCalls(ecs_iter_t* it)
+{
+    Position* position = ecs_column(it, Position, 1);
+    SpriteDraw* sprite = ecs_column(it, SpriteDraw, 2);
+    SpriteAnimation* animation = ecs_column(it, SpriteAnimation, 3); // optional
 
-        float fx = flip_offsets[sprite[i].flip & SPRITE_FLIP_X];
-        float fy = flip_offsets[sprite[i].flip & SPRITE_FLIP_Y];
+    // only this stage's array is written so tables can be processed on every worker thread
+    int32_t stage = ecs_get_stage_id(it->world);
+    TX_ASSERT(VALID_INDEX(stage, K_MAX_SPRITE_STAGES));
+    struct sprite** staged = &staged_sprites[stage];
 
-        float fw = flip_scales[sprite[i].flip & SPRITE_FLIP_X];
-        float fh = flip_scales[sprite[i].flip & SPRITE_FLIP_Y];
+    arrsetcap(*staged, arrlen(*staged) + it->count);
 
-        sprites[sprite_ct] = (struct sprite){
-            .pos =
-                (vec3){
-                    .x = position[i].x,
-                    .y = position[i].y,
-                    .z = sprite[i].layer,
-                },
-            .rect = {(col + fx) / 16.0f, (row + fy) / 16.0f, fw / 16, fh / 16},
+    for (int i = 0; i < it->count; ++i) {
+        sprite_draw_desc desc = {
+            .sprite_id = sprite[i].sprite_id,
+            .layer = sprite[i].layer,
+            .pos = position[i],
             .origin = sprite[i].origin,
+            .flip = sprite[i].flip,
         };
-        sprite_ct++;
+        if (animation) {
+            desc.sprite_id = animation[i].clip_start;
+            desc.anim = animation[i].anim;
+        }
+
+        if (!spr_in_view(desc.sprite_id, desc.pos, desc.origin)) {
+            continue;
+        }
+
+        arrput(*staged, sprite_from_desc(&desc));
     }
+}
 
-    spr_render();
+// Presents everything submitted this frame, runs once after every RenderSpriteDrawCalls invocation.
+void FlushSpriteRenderer(ecs_iter_t* it)
+{
+    render_time += it->delta_time;
+
+    int width = 0, height = 0;
+    sdl2_window_get_drawable_size(&width, &height);
+    spr_render(width, height);
 }
 
 void SystemSpriteRendererImport(ecs_world_t* world)
@@ -406,11 +1370,41 @@ void SystemSpriteRendererImport(ecs_world_t* world)
     ecs_atfini(world, spr_term, NULL);
 
     ECS_COMPONENT(world, SpriteDraw);
+    ECS_COMPONENT(world, SpriteAnimation);
+    ECS_COMPONENT(world, SpriteCamera);
 
     ECS_SYSTEM(
-        world, RenderSpriteDrawCalls, EcsOnStore, common.game.components.Position, SpriteDraw);
+        world, UpdateSpriteCamera, EcsPreStore, SpriteCamera, :common.game.components.Position);
+    // SpriteRenderSync is never added to an entity. RenderSpriteDrawCalls writing it and the flush
+    // reading it makes flecs put a merge point between them, so with worker threads every stage
+    // has finished staging its instances before the single flush of the frame.
+    ECS_TAG(world, SpriteRenderSync);
+
+    ECS_SYSTEM(
+        world,
+        RenderSpriteDrawCalls,
+        EcsOnStore,
+        common.game.components.Position,
+        SpriteDraw,
+        ?SpriteAnimation,
+        [out] :SpriteRenderSync);
+    ECS_SYSTEM(world, FlushSpriteRenderer, EcsOnStore, [in] :SpriteRenderSync);
 
     ECS_EXPORT_COMPONENT(SpriteDraw);
+    ECS_EXPORT_COMPONENT(SpriteAnimation);
+    ECS_EXPORT_COMPONENT(SpriteCamera);
 
     spr_init();
+}
+
+void SystemSpriteRendererHeadlessImport(ecs_world_t* world)
+{
+    ECS_MODULE(world, SystemSpriteRendererHeadless);
+
+    // must be chosen before the renderer module initializes
+    TX_ASSERT(ecs_lookup_fullpath(world, "system.sprite.renderer") == 0);
+    headless = true;
+
+    ECS_IMPORT(world, SystemSpriteRenderer);
+    *handles = ecs_module(SystemSpriteRenderer);
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "flecs.h"
+#include "handle.h"
 #include "sokol_gfx.h"
+#include "system_pool.h"
 #include "tx_math.h"
 #include "tx_types.h"
 
@@ -17,16 +19,98 @@ typedef enum sprite_flip {
     SPRITE_FLIP_Y = 2,
 } sprite_flip;
 
+typedef enum sprite_anim_mode {
+    SPRITE_ANIM_LOOP = 0,
+    SPRITE_ANIM_ONCE = 1, // holds the last frame once the clip has played
+    SPRITE_ANIM_PING_PONG = 2,
+} sprite_anim_mode;
+
+enum { SPRITE_ANIM_MAX_FRAMES = 255 };
+
+// Animation clips are runs of consecutive sprite ids. The frame is picked in the vertex shader from
+// the renderer clock so animated sprites cost nothing on the CPU once submitted.
+typedef struct sprite_anim {
+    uint32_t frame_count; // 0 or 1 draws sprite_id as is
+    float fps;            // below 256, stored with 1/256 precision
+    sprite_anim_mode mode;
+    float start_time; // spr_get_time() at which the first frame is shown
+} sprite_anim;
+
 typedef struct sprite_draw_desc {
-    uint32_t sprite_id;
-    float layer;
+    uint32_t sprite_id; // first frame when animated
+    float layer;        // drawn back to front, higher layers are drawn on top
     vec2 pos;
     vec2 origin;
     sprite_flip flip;
+    sprite_anim anim;
 } sprite_draw_desc;
 
+// Queues a sprite for this frame, main thread only. Entities with SpriteDraw are submitted by the
+// RenderSpriteDrawCalls system which is safe to run on flecs worker threads.
 void spr_draw(const sprite_draw_desc* desc);
 
+// Sprite ids are global across all atlases, this maps a cell of a given atlas to its sprite id.
+uint32_t spr_get_atlas_sprite_id(uint32_t atlas_index, uint32_t cell_index);
+
+// A sprite batch is an immutable set of instances uploaded to the GPU once at creation time and
+// drawn with a single instanced draw call, intended for static geometry like level tiles.
+typedef struct sprite_batch sprite_batch;
+DEFINE_HANDLE(sprite_batch);
+POOL_FORWARD(sprite_batch);
+
+sprite_batch_handle spr_batch_create(const sprite_draw_desc* descs, uint32_t count);
+void spr_batch_destroy(sprite_batch_handle handle);
+void spr_draw_batch(sprite_batch_handle handle);
+
+// instance data the batch holds on the GPU
+uint32_t spr_batch_get_bytes(sprite_batch_handle handle);
+
+// Camera used to frame the canvas, pos is the world position at the center of the view.
+// Sprites whose quads fall entirely outside of the view are culled before reaching the instance
+// buffer.
+void spr_set_camera(vec2 pos, float zoom);
+vec2 spr_get_camera_pos(void);
+
+// world space rectangle currently visible on the canvas
+void spr_get_view_bounds(vec2* min, vec2* max);
+
+// Seconds the renderer has been running, advanced by the world's delta time every flush. This is
+// the clock sprite animations are played against.
+float spr_get_time(void);
+
+// GPU passes timed with timer queries. The imgui pass is rendered outside of the sprite renderer so
+// whoever renders imgui brackets it with spr_gpu_pass_begin/end.
+typedef enum spr_gpu_pass {
+    SPR_GPU_PASS_CANVAS,
+    SPR_GPU_PASS_UPSCALE,
+    SPR_GPU_PASS_IMGUI,
+    SPR_GPU_PASS_COUNT,
+} spr_gpu_pass;
+
+typedef struct spr_render_stats {
+    uint32_t instances; // streamed and batched instances drawn
+    uint32_t batches;
+    uint32_t draw_calls;
+    uint32_t bytes_uploaded;          // instance data streamed to the GPU
+    float gpu_ms[SPR_GPU_PASS_COUNT]; // lags the counters by a few frames
+} spr_render_stats;
+
+// Dynamic resolution halves the canvas resolution while the canvas and upscale passes take longer
+// than budget_ms on the GPU and restores it when there is headroom again. Both resolutions are an
+// integer number of screen pixels per atlas texel so the output stays pixel perfect.
+void spr_set_dynamic_resolution(bool enabled, float budget_ms);
+
+// 1 at full canvas resolution, 2 at half
+uint32_t spr_get_canvas_divisor(void);
+
+// statistics of the last rendered frame
+spr_render_stats spr_get_render_stats(void);
+
+void spr_gpu_pass_begin(spr_gpu_pass pass);
+void spr_gpu_pass_end(spr_gpu_pass pass);
+
+void spr_render_stats_window(bool* show);
+
 typedef struct SpriteDraw {
     uint32_t sprite_id;
     sprite_flip flip;
@@ -34,10 +118,38 @@ typedef struct SpriteDraw {
     float layer;
 } SpriteDraw;
 
+// Plays a clip starting at clip_start on an entity's SpriteDraw, sprite_id is ignored while it is
+// present. Culling uses the size of the clip's first frame.
+typedef struct SpriteAnimation {
+    uint32_t clip_start;
+    sprite_anim anim;
+} SpriteAnimation;
+
+typedef struct SpriteCamera {
+    vec2 pos;
+    float zoom;          // <= 0 is treated as 1
+    ecs_entity_t follow; // when set the camera tracks this entity's Position
+} SpriteCamera;
+
 typedef struct SystemSpriteRenderer {
     ECS_DECLARE_COMPONENT(SpriteDraw);
+    ECS_DECLARE_COMPONENT(SpriteAnimation);
+    ECS_DECLARE_COMPONENT(SpriteCamera);
 } SystemSpriteRenderer;
 
 void SystemSpriteRendererImport(ecs_world_t* world);
 
-#define SystemSpriteRendererImportHandles(handles) ECS_IMPORT_COMPONENT(handles, SpriteDraw);
\ No newline at end of file
+#define SystemSpriteRendererImportHandles(handles)                                                 \
+    ECS_IMPORT_COMPONENT(handles, SpriteDraw);                                                     \
+    ECS_IMPORT_COMPONENT(handles, SpriteAnimation);                                                \
+    ECS_IMPORT_COMPONENT(handles, SpriteCamera);
+
+// Imports SystemSpriteRenderer without a graphics backend for running on machines with no display.
+// Sprites are culled, sorted and uploaded into a CPU side sink but never drawn. Must be imported
+// instead of SystemSpriteRenderer, not after it.
+typedef SystemSpriteRenderer SystemSpriteRendererHeadless;
+
+void SystemSpriteRendererHeadlessImport(ecs_world_t* world);
+
+#define SystemSpriteRendererHeadlessImportHandles(handles)                                         \
+    SystemSpriteRendererImportHandles(handles)
\ No newline at end of file
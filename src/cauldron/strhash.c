@@ -5,8 +5,13 @@
 #define STRPOOL_IMPLEMENTATION
 #include "strpool.h"
 
+#include <SDL2/SDL.h>
+
 strpool_t pool;
 
+// strings are interned from level parsing threads as well as the main thread
+SDL_SpinLock pool_lock = 0;
+
 void strhash_init()
 {
     strpool_init(
@@ -29,17 +34,26 @@ strhash strhash_get(const char* str)
 
 strhash strhash_get_len(const char* str, int len)
 {
+    SDL_AtomicLock(&pool_lock);
+    uint64_t value = strpool_inject(&pool, str, len);
+    SDL_AtomicUnlock(&pool_lock);
+
     return (strhash){
-        .value = (uint32_t)strpool_inject(&pool, str, len),
+        .value = (uint32_t)value,
     };
 }
 
 void strhash_discard(strhash str_hash)
 {
+    SDL_AtomicLock(&pool_lock);
     strpool_discard(&pool, (uint64_t)str_hash.value);
+    SDL_AtomicUnlock(&pool_lock);
 }
 
 const char* strhash_cstr(strhash str_hash)
 {
-    return strpool_cstr(&pool, (uint64_t)str_hash.value);
+    SDL_AtomicLock(&pool_lock);
+    const char* cstr = strpool_cstr(&pool, (uint64_t)str_hash.value);
+    SDL_AtomicUnlock(&pool_lock);
+    return cstr;
 }
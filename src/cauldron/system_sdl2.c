@@ -2,6 +2,7 @@
 
 #include "tx_input.h"
 #include <SDL2/SDL.h>
+#include <stdlib.h>
 
 void sdl2_term(ecs_world_t* world, void* ctx)
 {
@@ -42,6 +43,115 @@ static void Sdl2ProcessEvents(ecs_iter_t* it)
     }
 }
 
+// SDL threads return an int so the flecs callback and its result are carried through this
+struct sdl2_thread {
+    SDL_Thread* thread;
+    ecs_os_thread_callback_t callback;
+    void* param;
+    void* result;
+};
+
+static int sdl2_thread_main(void* data)
+{
+    struct sdl2_thread* thread = data;
+    thread->result = thread->callback(thread->param);
+    return 0;
+}
+
+static ecs_os_thread_t sdl2_thread_new(ecs_os_thread_callback_t callback, void* param)
+{
+    struct sdl2_thread* thread = calloc(1, sizeof(struct sdl2_thread));
+    thread->callback = callback;
+    thread->param = param;
+    thread->thread = SDL_CreateThread(sdl2_thread_main, "flecs worker", thread);
+    return (ecs_os_thread_t)thread;
+}
+
+static void* sdl2_thread_join(ecs_os_thread_t handle)
+{
+    struct sdl2_thread* thread = (struct sdl2_thread*)handle;
+    SDL_WaitThread(thread->thread, NULL);
+    void* result = thread->result;
+    free(thread);
+    return result;
+}
+
+static int sdl2_ainc(int32_t* value)
+{
+    return SDL_AtomicAdd((SDL_atomic_t*)value, 1) + 1;
+}
+
+static int sdl2_adec(int32_t* value)
+{
+    return SDL_AtomicAdd((SDL_atomic_t*)value, -1) - 1;
+}
+
+static ecs_os_mutex_t sdl2_mutex_new(void)
+{
+    return (ecs_os_mutex_t)SDL_CreateMutex();
+}
+
+static void sdl2_mutex_free(ecs_os_mutex_t mutex)
+{
+    SDL_DestroyMutex((SDL_mutex*)mutex);
+}
+
+static void sdl2_mutex_lock(ecs_os_mutex_t mutex)
+{
+    SDL_LockMutex((SDL_mutex*)mutex);
+}
+
+static void sdl2_mutex_unlock(ecs_os_mutex_t mutex)
+{
+    SDL_UnlockMutex((SDL_mutex*)mutex);
+}
+
+static ecs_os_cond_t sdl2_cond_new(void)
+{
+    return (ecs_os_cond_t)SDL_CreateCond();
+}
+
+static void sdl2_cond_free(ecs_os_cond_t cond)
+{
+    SDL_DestroyCond((SDL_cond*)cond);
+}
+
+static void sdl2_cond_signal(ecs_os_cond_t cond)
+{
+    SDL_CondSignal((SDL_cond*)cond);
+}
+
+static void sdl2_cond_broadcast(ecs_os_cond_t cond)
+{
+    SDL_CondBroadcast((SDL_cond*)cond);
+}
+
+static void sdl2_cond_wait(ecs_os_cond_t cond, ecs_os_mutex_t mutex)
+{
+    SDL_CondWait((SDL_cond*)cond, (SDL_mutex*)mutex);
+}
+
+void sdl2_set_ecs_os_api(void)
+{
+    ecs_os_set_api_defaults();
+
+    ecs_os_api_t api = ecs_os_api;
+    api.thread_new_ = sdl2_thread_new;
+    api.thread_join_ = sdl2_thread_join;
+    api.ainc_ = sdl2_ainc;
+    api.adec_ = sdl2_adec;
+    api.mutex_new_ = sdl2_mutex_new;
+    api.mutex_free_ = sdl2_mutex_free;
+    api.mutex_lock_ = sdl2_mutex_lock;
+    api.mutex_unlock_ = sdl2_mutex_unlock;
+    api.cond_new_ = sdl2_cond_new;
+    api.cond_free_ = sdl2_cond_free;
+    api.cond_signal_ = sdl2_cond_signal;
+    api.cond_broadcast_ = sdl2_cond_broadcast;
+    api.cond_wait_ = sdl2_cond_wait;
+    ecs_os_set_api(&api);
+}
+
 void SystemSdl2Import(ecs_world_t* world)
 {
     ECS_MODULE(world, SystemSdl2);
@@ -8,4 +8,8 @@ typedef struct SystemSdl2 {
 
 void SystemSdl2Import(ecs_world_t* world);
 
-#define SystemSdl2ImportHandles(handles) ECS_IMPORT_ENTITY(handles, Sdl2);
\ No newline at end of file
+#define SystemSdl2ImportHandles(handles) ECS_IMPORT_ENTITY(handles, Sdl2);
+
+// Provides the flecs threading OS API with SDL2 threads, mutexes and condition variables so worker
+// threads can be enabled with ecs_set_threads. Must be called before the world is created.
+void sdl2_set_ecs_os_api(void);
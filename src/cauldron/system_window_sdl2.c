@@ -3,6 +3,10 @@
 #include <GL/gl3w.h>
 #include <SDL2/SDL.h>
 
+// the game creates a single window, renderers query its size through
+// sdl2_window_get_drawable_size
+SDL_Window* drawable_window = NULL;
+
 static void Sdl2CreateWindow(ecs_iter_t* it)
 {
     WindowDesc* window_desc = ecs_column(it, WindowDesc, 1);
@@ -31,6 +35,7 @@ static void Sdl2CreateWindow(ecs_iter_t* it)
             }
 
             window->window = window_ptr;
+            drawable_window = window_ptr;
         }
 
         window->gl = SDL_GL_CreateContext(window->window);
@@ -48,6 +53,9 @@ static void Sdl2DestroyWindow(ecs_iter_t* it)
     Sdl2Window* window = ecs_column(it, Sdl2Window, 1);
 
     for (int i = 0; i < it->count; ++i) {
+        if (window->window == drawable_window) {
+            drawable_window = NULL;
+        }
         SDL_GL_DeleteContext(window->gl);
         SDL_DestroyWindow(window->window);
     }
@@ -64,6 +72,17 @@ static void Sdl2SwapWindow(ecs_iter_t* it)
     }
 }
 
+void sdl2_window_get_drawable_size(int* width, int* height)
+{
+    *width = 0;
+    *height = 0;
+
+    // minimized windows can still report their restored size
+    if (drawable_window && !(SDL_GetWindowFlags(drawable_window) & SDL_WINDOW_MINIMIZED)) {
+        SDL_GL_GetDrawableSize(drawable_window, width, height);
+    }
+}
+
 void SystemSdl2WindowImport(ecs_world_t* world)
 {
     ECS_MODULE(world, SystemSdl2Window);
@@ -80,7 +99,8 @@ void SystemSdl2WindowImport(ecs_world_t* world)
     // clang-format on
 
     ECS_SYSTEM(world, Sdl2DestroyWindow, EcsUnSet, Sdl2Window);
-    ECS_SYSTEM(world, Sdl2SwapWindow, EcsOnStore, Sdl2Window);
+    // after everything in EcsOnStore so the frame's rendering has been flushed
+    ECS_SYSTEM(world, Sdl2SwapWindow, EcsPostFrame, Sdl2Window);
 
     ECS_EXPORT_COMPONENT(WindowDesc);
 }
\ No newline at end of file
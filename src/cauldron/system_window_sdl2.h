@@ -22,4 +22,8 @@ typedef struct SystemSdl2Window {
 
 void SystemSdl2WindowImport(ecs_world_t* world);
 
+// Size of the window's GL drawable in pixels, 0x0 while the window is minimized or before it has
+// been created.
+void sdl2_window_get_drawable_size(int* width, int* height);
+
 #define SystemSdl2WindowImportHandles(handles) ECS_IMPORT_COMPONENT(handles, WindowDesc);
\ No newline at end of file
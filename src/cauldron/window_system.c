@@ -1,6 +1,7 @@
 #include "window_system.h"
 
 #include "game_settings.h"
+#include "sprite_draw.h"
 #include <GL/gl3w.h>
 #include <SDL2/SDL.h>
 
@@ -101,5 +102,7 @@ void imgui_begin(float dt)
 void imgui_end(void)
 {
     igRender();
+    spr_gpu_pass_begin(SPR_GPU_PASS_IMGUI);
     ImGui_ImplOpenGL3_RenderDrawData(igGetDrawData());
+    spr_gpu_pass_end(SPR_GPU_PASS_IMGUI);
 }